@@ -12,6 +12,11 @@ class timer {
 
  public:
   void start() { t0 = Clock::now(); }
+  double elapsed() const {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+               Clock::now() - t0)
+        .count();
+  }
   void stop() {
     time_point t1 = Clock::now();
     std::cout << std::setw(15)
@@ -0,0 +1,110 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <sys/mman.h>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+// Time to grow a single stack to n nodes, with the nodes coming from:
+//  - default: std::allocator
+//  - arena: a std::pmr::monotonic_buffer_resource, nothing is given back
+//    until the pool dies (for aos_layout this includes the buffers left
+//    behind by the reallocations of the vector)
+//  - huge pages: the same arena, whose chunks are mmap'ed and advised with
+//    MADV_HUGEPAGE (transparent huge pages must be enabled, see
+//    /sys/kernel/mm/transparent_hugepage/enabled)
+// for aos_layout and segmented_layout. Needs C++17 for std::pmr.
+//
+// usage: ./bench_alloc.x [max_nodes]
+
+using stack_type = std::uint32_t;
+
+/** Memory resource handing out 2 MiB aligned chunks of anonymous memory,
+ * advised to be backed by huge pages. */
+class huge_page_resource : public std::pmr::memory_resource {
+  static constexpr std::size_t page = std::size_t(2) << 20;
+
+  static std::size_t round_up(std::size_t bytes) {
+    return (bytes + page - 1) / page * page;
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t) override {
+    const auto n = round_up(bytes);
+    // map one more huge page, to cut an aligned region out of it
+    auto p = ::mmap(nullptr, n + page, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc{};
+    const auto begin = reinterpret_cast<std::uintptr_t>(p);
+    const auto aligned = (begin + page - 1) / page * page;
+    if (aligned > begin)
+      ::munmap(p, aligned - begin);
+    if (aligned + n < begin + n + page)
+      ::munmap(reinterpret_cast<void*>(aligned + n), begin + page - aligned);
+    ::madvise(reinterpret_cast<void*>(aligned), n, MADV_HUGEPAGE);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t) override {
+    ::munmap(p, round_up(bytes));
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+};
+
+template <typename Pool>
+void grow(Pool& pool,
+          const std::string& layout,
+          const std::string& resource,
+          std::size_t n) {
+  timer<> t;
+  auto l = pool.new_stack();
+  std::cout << std::setw(12) << layout << std::setw(12) << resource
+            << std::setw(12) << n << "\t";
+  t.start();
+  for (std::size_t i = 0; i < n; ++i)
+    l = pool.push(int(i), l);
+  t.stop();
+}
+
+template <typename L>
+void bench(const std::string& layout, std::size_t n) {
+  using pmr_pool =
+      stack_pool<int, stack_type, L, checked, std::pmr::polymorphic_allocator<int>>;
+  {
+    stack_pool<int, stack_type, L> pool{};
+    grow(pool, layout, "default", n);
+  }
+  {
+    std::pmr::monotonic_buffer_resource arena{std::pmr::new_delete_resource()};
+    pmr_pool pool{&arena};
+    grow(pool, layout, "arena", n);
+  }
+  {
+    huge_page_resource huge;
+    std::pmr::monotonic_buffer_resource arena{std::size_t(2) << 20, &huge};
+    pmr_pool pool{&arena};
+    grow(pool, layout, "huge pages", n);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t max_nodes = 100000000;
+  if (argc > 1)
+    max_nodes = std::atol(argv[1]);
+
+  std::cout << std::setw(12) << "layout" << std::setw(12) << "resource"
+            << std::setw(12) << "nodes" << std::endl;
+  for (std::size_t n = 1 << 20; n != 0;
+       n = n == max_nodes ? 0 : std::min(4 * n, max_nodes)) {
+    bench<aos_layout>("aos", n);
+    bench<segmented_layout<>>("segmented", n);
+  }
+}
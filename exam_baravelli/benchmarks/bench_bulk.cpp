@@ -0,0 +1,89 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Ingest of n values one push() at a time against a single push_range(),
+// both on a fresh pool and on a pool whose nodes are all free, and draining
+// them with pop() against pop_n().
+//
+// usage: ./bench_bulk.x [max_nodes]
+
+using stack_type = std::uint32_t;
+
+void print(const std::string& name, std::size_t n) {
+  std::cout << std::setw(25) << name << std::setw(12) << n << "\t";
+}
+
+void bench(std::size_t n) {
+  timer<> t;
+  std::vector<double> values(n);
+  std::iota(values.begin(), values.end(), 0.);
+  std::vector<double> out;
+  out.reserve(n);
+
+  {
+    stack_pool<double, stack_type> pool{};
+    auto l = pool.new_stack();
+    print("push, fresh", n);
+    t.start();
+    for (auto x : values)
+      l = pool.push(x, l);
+    t.stop();
+
+    l = pool.free_stack(l);
+    print("push, free nodes", n);
+    t.start();
+    for (auto x : values)
+      l = pool.push(x, l);
+    t.stop();
+
+    print("pop", n);
+    t.start();
+    while (!pool.empty(l)) {
+      out.push_back(pool.value(l));
+      l = pool.pop(l);
+    }
+    t.stop();
+  }
+
+  {
+    out.clear();
+    stack_pool<double, stack_type> pool{};
+    auto l = pool.new_stack();
+    print("push_range, fresh", n);
+    t.start();
+    l = pool.push_range(values.begin(), values.end(), l);
+    t.stop();
+
+    l = pool.free_stack(l);
+    print("push_range, free nodes", n);
+    t.start();
+    l = pool.push_range(values.begin(), values.end(), l);
+    t.stop();
+
+    print("pop_n", n);
+    t.start();
+    l = pool.pop_n(l, n, std::back_inserter(out));
+    t.stop();
+    if (out.size() != n || out.front() != values.back())
+      std::cerr << "wrong values" << std::endl;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t max_nodes = 1 << 24;
+  if (argc > 1)
+    max_nodes = std::atol(argv[1]);
+
+  std::cout << std::setw(25) << "operation" << std::setw(12) << "nodes"
+            << std::endl;
+  for (std::size_t n = 1 << 16; n <= max_nodes; n <<= 2)
+    bench(n);
+}
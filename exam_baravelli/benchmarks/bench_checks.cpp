@@ -0,0 +1,54 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// std::max_element over a single stack of n nodes, under each checking
+// policy. The nodes are pushed in order, so the stack is walked backwards
+// through the pool, as it happens after the pool has been used for a while.
+// Built twice by the Makefile:
+//  - bench_checks.x: debug_assert checks like checked
+//  - bench_checks_ndebug.x: -DNDEBUG, debug_assert checks nothing
+//
+// usage: ./bench_checks.x [nodes]
+
+using stack_type = std::uint32_t;
+
+template <typename C>
+void bench(const std::string& name, std::size_t n) {
+  timer<> t;
+  stack_pool<int, stack_type, aos_layout, C> pool{n};
+  auto l = pool.new_stack();
+  for (std::size_t i = 0; i < n; ++i)
+    l = pool.push(int(i % 1000003), l);
+
+  std::cout << std::setw(15) << name << std::setw(12) << n << "\t";
+  t.start();
+  auto m = std::max_element(pool.cbegin(l), pool.cend(l));
+  t.stop();
+  if (*m != 1000002 && n > 1000002)
+    std::cerr << "wrong maximum" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t n = 10000000;
+  if (argc > 1)
+    n = std::atol(argv[1]);
+
+#ifdef NDEBUG
+  std::cout << "# NDEBUG defined\n";
+#else
+  std::cout << "# NDEBUG not defined\n";
+#endif
+  std::cout << std::setw(15) << "policy" << std::setw(12) << "nodes"
+            << std::endl;
+  for (int round = 0; round < 2; ++round) {
+    bench<checked>("checked", n);
+    bench<debug_assert>("debug_assert", n);
+    bench<unchecked>("unchecked", n);
+  }
+}
@@ -0,0 +1,121 @@
+#include "concurrent_stack_pool.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Throughput of concurrent_stack_pool against a stack_pool protected by a
+// mutex, for an increasing number of threads. Each thread does the same
+// amount of work, so with perfect scaling the time stays constant.
+//
+// usage: ./bench_concurrent.x [max_threads] [ops_per_thread]
+
+using value_type = int;
+using stack_type = std::uint32_t;
+
+// stack_pool with every operation serialized by a mutex
+class locked_stack_pool {
+  stack_pool<value_type, stack_type> pool;
+  std::mutex m;
+
+ public:
+  stack_type push(value_type v, stack_type head) {
+    std::lock_guard<std::mutex> lock{m};
+    return pool.push(v, head);
+  }
+  stack_type pop(stack_type x) {
+    std::lock_guard<std::mutex> lock{m};
+    return pool.pop(x);
+  }
+  // shared stack: the head itself lives under the lock
+  void push_shared(value_type v, stack_type& head) {
+    std::lock_guard<std::mutex> lock{m};
+    head = pool.push(v, head);
+  }
+  bool try_pop_shared(stack_type& head, value_type& out) {
+    std::lock_guard<std::mutex> lock{m};
+    if (pool.empty(head))
+      return false;
+    out = pool.value(head);
+    head = pool.pop(head);
+    return true;
+  }
+};
+
+constexpr int burst = 64;
+
+// each thread churns its own stack: push a burst, pop it back
+template <typename P>
+void private_churn(P& pool, std::size_t ops) {
+  auto l = stack_type(0);
+  for (std::size_t i = 0; i < ops; i += 2 * burst) {
+    for (int j = 0; j < burst; ++j)
+      l = pool.push(j, l);
+    for (int j = 0; j < burst; ++j)
+      l = pool.pop(l);
+  }
+}
+
+template <typename F>
+void run(const char* name, int n_threads, F f) {
+  timer<> t;
+  std::vector<std::thread> threads;
+  std::cout << std::setw(10) << n_threads << std::setw(28) << name << "\t";
+  t.start();
+  for (int i = 0; i < n_threads; ++i)
+    threads.emplace_back(f);
+  for (auto& th : threads)
+    th.join();
+  t.stop();
+}
+
+int main(int argc, char* argv[]) {
+  int max_threads = std::max(2u, 2 * std::thread::hardware_concurrency());
+  std::size_t ops = 1 << 22;
+  if (argc > 1)
+    max_threads = std::atoi(argv[1]);
+  if (argc > 2)
+    ops = std::atol(argv[2]);
+
+  std::cout << "# " << ops << " operations per thread, "
+            << std::thread::hardware_concurrency() << " hardware threads\n";
+  std::cout << std::setw(10) << "threads" << std::setw(28) << "variant"
+            << std::endl;
+  for (int n = 1; n <= max_threads; n <<= 1) {
+    {
+      concurrent_stack_pool<value_type, stack_type> pool{};
+      run("private/lock-free", n, [&pool, ops] { private_churn(pool, ops); });
+    }
+    {
+      locked_stack_pool pool{};
+      run("private/mutex", n, [&pool, ops] { private_churn(pool, ops); });
+    }
+    {
+      concurrent_stack_pool<value_type, stack_type> pool{};
+      concurrent_stack_pool<value_type, stack_type>::shared_stack s;
+      run("shared/treiber", n, [&pool, &s, ops] {
+        value_type v;
+        for (std::size_t i = 0; i < ops; i += 2) {
+          pool.push(s, int(i));
+          pool.try_pop(s, v);
+        }
+      });
+    }
+    {
+      locked_stack_pool pool{};
+      stack_type head{0};
+      run("shared/mutex", n, [&pool, &head, ops] {
+        value_type v;
+        for (std::size_t i = 0; i < ops; i += 2) {
+          pool.push_shared(int(i), head);
+          pool.try_pop_shared(head, v);
+        }
+      });
+    }
+  }
+}
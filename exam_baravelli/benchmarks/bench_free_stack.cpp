@@ -0,0 +1,63 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Time needed to free n stacks of mixed length (1 to 32 nodes), in doubling
+// steps of n up to max_stacks (the last step is max_stacks itself).
+// Built twice by the Makefile:
+//  - bench_free_stack.x: constant time free_stack (freed segments)
+//  - bench_free_stack_legacy.x: -DSTACK_POOL_WALK_FREE_LIST, free_stack walks
+//    the free list every time, hence the quadratic growth
+//
+// usage: ./bench_free_stack.x [max_stacks]
+
+int main(int argc, char* argv[]) {
+  using stack_type = std::uint32_t;
+  std::size_t max_stacks = 100000;
+  if (argc > 1)
+    max_stacks = std::atol(argv[1]);
+
+#ifdef STACK_POOL_WALK_FREE_LIST
+  std::cout << "# free_stack walking the free list\n";
+#else
+  std::cout << "# free_stack with freed segments\n";
+#endif
+  std::cout << std::setw(15) << "stacks" << std::setw(15) << "nodes"
+            << std::endl;
+
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> length{1, 32};
+  timer<> t;
+  for (std::size_t n = std::min<std::size_t>(1024, max_stacks); n != 0;
+       n = n == max_stacks ? 0 : std::min(2 * n, max_stacks)) {
+    stack_pool<int, stack_type> pool{};
+    std::vector<stack_type> heads(n);
+    std::size_t nodes = 0;
+    for (auto& h : heads) {
+      const auto l = length(gen);
+      for (int i = 0; i < l; ++i)
+        h = pool.push(i, h);
+      nodes += l;
+    }
+    std::shuffle(heads.begin(), heads.end(), gen);
+
+    std::cout << std::setw(15) << n << std::setw(15) << nodes << "\t";
+    t.start();
+    for (auto& h : heads)
+      h = pool.free_stack(h);
+    t.stop();
+
+    // the nodes are all reused, whatever the shape of the free list
+    auto l = pool.new_stack();
+    for (std::size_t i = 0; i < nodes; ++i)
+      l = pool.push(0, l);
+    if (pool.psize() != nodes)
+      std::cerr << "unexpected pool growth" << std::endl;
+  }
+}
@@ -0,0 +1,53 @@
+#include "generational_pool.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Cost of the generation check: n nodes pushed round robin on 8 stacks and
+// popped again, twice, on a stack_pool with checked and unchecked indexes
+// and on a generational_pool, whose heads are checked at every call.
+//
+// usage: ./bench_generational.x [nodes]
+
+using stack_type = std::uint32_t;
+constexpr int n_stacks = 8;
+
+template <typename P>
+void bench(const std::string& name, std::size_t n) {
+  timer<> t;
+  P pool{n};
+  std::vector<stack_type> heads(n_stacks, pool.new_stack());
+  long sum = 0;
+
+  std::cout << std::setw(15) << name << std::setw(12) << n << "\t";
+  t.start();
+  for (int round = 0; round < 2; ++round) {
+    for (std::size_t i = 0; i < n; ++i)
+      heads[i % n_stacks] = pool.push(int(i), heads[i % n_stacks]);
+    for (auto& h : heads)
+      while (!pool.empty(h)) {
+        sum += pool.value(h);
+        h = pool.pop(h);
+      }
+  }
+  t.stop();
+  if (sum != long(n) * (long(n) - 1))
+    std::cerr << "wrong sum" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t n = 10000000;
+  if (argc > 1)
+    n = std::atol(argv[1]);
+
+  std::cout << std::setw(15) << "pool" << std::setw(12) << "nodes"
+            << std::endl;
+  bench<stack_pool<int, stack_type, aos_layout, checked>>("checked", n);
+  bench<stack_pool<int, stack_type, aos_layout, unchecked>>("unchecked", n);
+  bench<generational_pool<int, stack_type, 8>>("generational", n);
+}
@@ -0,0 +1,54 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Growth of a pool without any reserve: total time to push n nodes and the
+// slowest single push, i.e. the reallocation spike of aos_layout that
+// segmented_layout does not have.
+//
+// usage: ./bench_growth.x [max_nodes]
+
+using stack_type = std::uint32_t;
+
+template <typename L>
+void bench(const std::string& name, std::size_t n) {
+  using clock = std::chrono::steady_clock;
+  timer<> t;
+  stack_pool<double, stack_type, L> pool{};
+  auto l = pool.new_stack();
+  clock::duration worst{0};
+
+  std::cout << std::setw(20) << name << std::setw(12) << n << "\t";
+  t.start();
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto t0 = clock::now();
+    l = pool.push(double(i), l);
+    const auto dt = clock::now() - t0;
+    if (dt > worst)
+      worst = dt;
+  }
+  t.stop();
+  std::cout << std::setw(20) << name << std::setw(12) << n << "\t"
+            << std::setw(15)
+            << std::chrono::duration_cast<std::chrono::duration<double>>(worst)
+                   .count()
+            << " [seconds, slowest push]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t max_nodes = 1 << 24;
+  if (argc > 1)
+    max_nodes = std::atol(argv[1]);
+
+  std::cout << std::setw(20) << "layout" << std::setw(12) << "nodes"
+            << std::endl;
+  for (std::size_t n = 1 << 16; n <= max_nodes; n <<= 2) {
+    bench<aos_layout>("aos", n);
+    bench<segmented_layout<>>("segmented", n);
+  }
+}
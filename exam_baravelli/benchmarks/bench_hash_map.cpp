@@ -0,0 +1,98 @@
+#include "pool_hash_map.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Word frequency, the exercise on LittleWomen.txt of session 03: the words
+// (separated by white space, as read by std::cin >> word) are counted
+//  - unordered_map: std::unordered_map<std::string, int>, ++map[word]
+//  - pool: pool_hash_map<std::string, int>, ++map[word]
+//  - pool lookup: pool_hash_map with a transparent hash of std::string_view,
+//    the words are looked up in place and a std::string is built only for
+//    the first occurrence of each word
+// The text is read and split once; best time of `reps` counts, number of
+// distinct words and checksum of the counts. Needs C++17 for std::string_view.
+//
+// usage: ./bench_hash_map.x [file] [reps]
+
+struct view_hash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view s) const noexcept {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+template <typename Map, typename F>
+void run(const char* name, const std::vector<std::string_view>& words,
+         int reps, F key) {
+  double best = 0;
+  std::size_t distinct = 0;
+  long long checksum = 0;
+  timer<> t;
+  for (int r = 0; r < reps; ++r) {
+    t.start();
+    Map map{};
+    for (auto w : words)
+      ++map[key(w)];
+    const auto e = t.elapsed();
+    best = r == 0 ? e : std::min(best, e);
+    distinct = map.size();
+    checksum = 0;
+    for (const auto& kv : map)
+      checksum += kv.second * (long long)kv.first.size();
+  }
+  std::cout << std::setw(15) << name << std::setw(15) << best << std::setw(12)
+            << distinct << std::setw(15) << checksum << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::string file =
+      "../../c++/03_more_on_pointers_and_vectors/exercises/LittleWomen.txt";
+  int reps = 10;
+  if (argc > 1)
+    file = argv[1];
+  if (argc > 2)
+    reps = std::atoi(argv[2]);
+
+  std::ifstream in{file};
+  if (!in) {
+    std::cerr << "cannot open " << file << std::endl;
+    return 1;
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  const std::string text = buffer.str();
+
+  std::vector<std::string_view> words;
+  for (std::size_t i = 0; i < text.size();) {
+    while (i < text.size() && std::isspace((unsigned char)text[i]))
+      ++i;
+    const auto first = i;
+    while (i < text.size() && !std::isspace((unsigned char)text[i]))
+      ++i;
+    if (i > first)
+      words.emplace_back(text.data() + first, i - first);
+  }
+
+  std::cout << words.size() << " words" << std::endl;
+  std::cout << std::setw(15) << "map" << std::setw(15) << "[seconds]"
+            << std::setw(12) << "distinct" << std::setw(15) << "checksum"
+            << std::endl;
+  auto copy = [](std::string_view w) { return std::string{w}; };
+  auto view = [](std::string_view w) { return w; };
+  run<std::unordered_map<std::string, int>>("unordered_map", words, reps,
+                                            copy);
+  run<pool_hash_map<std::string, int>>("pool", words, reps, copy);
+  run<pool_hash_map<std::string, int, view_hash, std::equal_to<>>>(
+      "pool lookup", words, reps, view);
+}
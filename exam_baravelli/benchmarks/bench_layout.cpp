@@ -0,0 +1,91 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// aos_layout against soa_layout, for a small and a large value type.
+// The nodes are pushed round robin on 8 stacks, so that walking one stack
+// jumps over the nodes of the others, as it happens in a used pool.
+//  - ssize: walks every stack touching only the links
+//  - sum: walks every stack reading the values too
+//  - push/pop: fills the 8 stacks and empties them again, twice
+//
+// usage: ./bench_layout.x [max_nodes]
+
+using stack_type = std::uint32_t;
+constexpr int n_stacks = 8;
+
+struct large {
+  std::array<double, 16> data{};
+  large() = default;
+  large(int i) { data[0] = i; }
+};
+
+double first(int x) {
+  return x;
+}
+double first(const large& x) {
+  return x.data[0];
+}
+
+template <typename T, typename L>
+void bench(const std::string& name, std::size_t n) {
+  timer<> t;
+  stack_pool<T, stack_type, L> pool{};
+  std::vector<stack_type> heads(n_stacks);
+  for (std::size_t i = 0; i < n; ++i)
+    heads[i % n_stacks] = pool.push(T(int(i)), heads[i % n_stacks]);
+
+  std::cout << std::setw(30) << name << std::setw(12) << n << std::setw(12)
+            << "ssize" << "\t";
+  std::size_t size = 0;
+  t.start();
+  for (auto h : heads)
+    size += pool.ssize(h);
+  t.stop();
+  if (size != n)
+    std::cerr << "wrong size" << std::endl;
+
+  std::cout << std::setw(30) << name << std::setw(12) << n << std::setw(12)
+            << "sum" << "\t";
+  double sum = 0;
+  t.start();
+  for (auto h : heads)
+    for (auto it = pool.cbegin(h); it != pool.cend(h); ++it)
+      sum += first(*it);
+  t.stop();
+  if (sum != double(n) * (n - 1) / 2)
+    std::cerr << "wrong sum" << std::endl;
+
+  std::cout << std::setw(30) << name << std::setw(12) << n << std::setw(12)
+            << "push/pop" << "\t";
+  t.start();
+  for (int round = 0; round < 2; ++round) {
+    for (auto& h : heads)
+      while (!pool.empty(h))
+        h = pool.pop(h);
+    for (std::size_t i = 0; i < n; ++i)
+      heads[i % n_stacks] = pool.push(T(int(i)), heads[i % n_stacks]);
+  }
+  t.stop();
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t max_nodes = 1 << 20;
+  if (argc > 1)
+    max_nodes = std::atol(argv[1]);
+
+  std::cout << std::setw(30) << "layout, value" << std::setw(12) << "nodes"
+            << std::setw(12) << "operation" << std::endl;
+  for (std::size_t n = 1 << 12; n <= max_nodes; n <<= 2) {
+    bench<int, aos_layout>("aos, int", n);
+    bench<int, soa_layout>("soa, int", n);
+    bench<large, aos_layout>("aos, 128 bytes", n);
+    bench<large, soa_layout>("soa, 128 bytes", n);
+  }
+}
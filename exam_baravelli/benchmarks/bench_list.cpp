@@ -0,0 +1,129 @@
+#include "list_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// A scheduler: `tasks` tasks are queued round robin on `lists` run lists,
+// then `moves` times a random task moves to the back of a random list,
+// then every list is walked, then the tasks are erased in random order.
+//  - std::list: one std::list<int> per run list, a task is an iterator
+//  - list_pool: all the lists in one list_pool<int, uint32_t>, a task is a node
+//  - unchecked: the same, with the unchecked policy (see pool_checks.hpp)
+// Time of each phase, and checksum of the walk.
+//
+// usage: ./bench_list.x [lists] [tasks] [moves]
+
+using stack_type = std::uint32_t;
+
+// list_pool with the checking policy C
+template <typename C>
+void run_pool(const char* name, std::size_t lists, std::size_t tasks,
+              const std::vector<std::uint32_t>& task,
+              const std::vector<std::uint32_t>& target,
+              const std::vector<std::uint32_t>& order) {
+  list_pool<int, stack_type, aos_layout, C> pool{};
+  std::vector<typename decltype(pool)::list> ls(lists, pool.new_list());
+  std::vector<stack_type> nodes(tasks);
+  std::vector<std::uint32_t> owner(tasks);
+  timer<> t;
+
+  std::cout << std::setw(12) << name << std::setw(12) << "build" << "\t";
+  t.start();
+  for (std::size_t i = 0; i < tasks; ++i) {
+    owner[i] = i % lists;
+    nodes[i] = pool.push_back(ls[owner[i]], int(i));
+  }
+  t.stop();
+  std::cout << std::setw(24) << "move" << "\t";
+  t.start();
+  for (std::size_t i = 0; i < task.size(); ++i) {
+    const auto x = task[i];
+    pool.splice(ls[target[i]], pool.end(), ls[owner[x]], nodes[x]);
+    owner[x] = target[i];
+  }
+  t.stop();
+  long long sum = 0;
+  std::cout << std::setw(24) << "walk" << "\t";
+  t.start();
+  for (const auto& l : ls)
+    for (auto it = pool.cbegin(l); it != pool.cend(l); ++it)
+      sum = sum * 31 + *it;
+  t.stop();
+  std::cout << std::setw(24) << "erase" << "\t";
+  t.start();
+  for (auto x : order)
+    pool.erase(ls[owner[x]], nodes[x]);
+  t.stop();
+  std::cout << std::setw(24) << sum << "\t[checksum]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t lists = 10000;
+  std::size_t tasks = 1000000;
+  std::size_t moves = 10000000;
+  if (argc > 1)
+    lists = std::atol(argv[1]);
+  if (argc > 2)
+    tasks = std::atol(argv[2]);
+  if (argc > 3)
+    moves = std::atol(argv[3]);
+
+  // the same moves and erase order for both
+  std::mt19937 gen{42};
+  std::vector<std::uint32_t> task(moves), target(moves);
+  for (std::size_t i = 0; i < moves; ++i) {
+    task[i] = gen() % tasks;
+    target[i] = gen() % lists;
+  }
+  std::vector<std::uint32_t> order(tasks);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), gen);
+
+  timer<> t;
+  std::cout << std::setw(12) << "list" << std::setw(12) << "phase"
+            << std::endl;
+  {
+    std::vector<std::list<int>> ls(lists);
+    std::vector<std::list<int>::iterator> nodes(tasks);
+    std::vector<std::uint32_t> owner(tasks);
+
+    std::cout << std::setw(12) << "std::list" << std::setw(12) << "build"
+              << "\t";
+    t.start();
+    for (std::size_t i = 0; i < tasks; ++i) {
+      owner[i] = i % lists;
+      nodes[i] = ls[owner[i]].insert(ls[owner[i]].end(), int(i));
+    }
+    t.stop();
+    std::cout << std::setw(24) << "move" << "\t";
+    t.start();
+    for (std::size_t i = 0; i < moves; ++i) {
+      const auto x = task[i];
+      ls[target[i]].splice(ls[target[i]].end(), ls[owner[x]], nodes[x]);
+      owner[x] = target[i];
+    }
+    t.stop();
+    long long sum = 0;
+    std::cout << std::setw(24) << "walk" << "\t";
+    t.start();
+    for (const auto& l : ls)
+      for (auto v : l)
+        sum = sum * 31 + v;
+    t.stop();
+    std::cout << std::setw(24) << "erase" << "\t";
+    t.start();
+    for (auto x : order)
+      ls[owner[x]].erase(nodes[x]);
+    t.stop();
+    std::cout << std::setw(24) << sum << "\t[checksum]" << std::endl;
+  }
+  run_pool<checked>("list_pool", lists, tasks, task, target, order);
+  run_pool<unchecked>("unchecked", lists, tasks, task, target, order);
+}
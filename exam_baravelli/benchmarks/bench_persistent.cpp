@@ -0,0 +1,70 @@
+#include "persistent_pool.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Forking a search path: a stack of `length` nodes is forked `versions`
+// times, and each version gets 4 more nodes.
+//  - copy: stack_pool, each version is a copy of the path (push_range)
+//  - persistent: persistent_pool, each version shares the path
+// Time and number of nodes in the pool.
+//
+// usage: ./bench_persistent.x [length] [versions]
+
+using stack_type = std::uint32_t;
+constexpr int extra = 4;
+
+int main(int argc, char* argv[]) {
+  std::size_t length = 10000;
+  std::size_t versions = 1000;
+  if (argc > 1)
+    length = std::atol(argv[1]);
+  if (argc > 2)
+    versions = std::atol(argv[2]);
+
+  timer<> t;
+  std::cout << std::setw(12) << "pool" << std::setw(12) << "versions"
+            << std::endl;
+  {
+    stack_pool<int, stack_type> pool{};
+    auto path = pool.new_stack();
+    for (std::size_t i = 0; i < length; ++i)
+      path = pool.push(int(i), path);
+    std::vector<int> buffer(pool.cbegin(path), pool.cend(path));
+    std::vector<stack_type> forks(versions);
+
+    std::cout << std::setw(12) << "copy" << std::setw(12) << versions << "\t";
+    t.start();
+    for (auto& f : forks) {
+      f = pool.push_range(buffer.rbegin(), buffer.rend(), pool.new_stack());
+      for (int i = 0; i < extra; ++i)
+        f = pool.push(-i, f);
+    }
+    t.stop();
+    std::cout << std::setw(24) << pool.psize() << "\t[nodes]" << std::endl;
+  }
+  {
+    persistent_pool<int, stack_type> pool{};
+    auto path = pool.new_stack();
+    for (std::size_t i = 0; i < length; ++i)
+      path = pool.push(int(i), path);
+    std::vector<stack_type> forks(versions);
+
+    std::cout << std::setw(12) << "persistent" << std::setw(12) << versions
+              << "\t";
+    t.start();
+    for (auto& f : forks) {
+      f = pool.share(path);
+      for (int i = 0; i < extra; ++i)
+        f = pool.push(-i, f);
+    }
+    t.stop();
+    std::cout << std::setw(24) << pool.psize() << "\t[nodes]" << std::endl;
+    if (pool.ssize(forks.back()) != length + extra)
+      std::cerr << "wrong length" << std::endl;
+  }
+}
@@ -0,0 +1,107 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Sum of all the values of a pool of n nodes spread over many stacks, with
+// each traversal of stack_pool:
+//  - iterator: cbegin/cend, the next node is requested after the increment
+//  - prefetch iterator: pbegin/pend, one node ahead
+//  - for_each: one node ahead, without the iterator checks
+//  - lockstep: for_each_lockstep, 8 and 32 stacks at a time
+// on two pools:
+//  - shuffled: each node is pushed on a random stack, so walking a stack
+//    jumps around the whole pool, a cache miss at each step
+//  - compacted: the same stacks after compact(), each one contiguous
+//
+// usage: ./bench_prefetch.x [nodes] [stacks]
+
+using stack_type = std::uint32_t;
+using pool_type = stack_pool<double, stack_type>;
+
+void print(const std::string& pool, const std::string& name, std::size_t n) {
+  std::cout << std::setw(12) << pool << std::setw(22) << name << std::setw(12)
+            << n << "\t";
+}
+
+void check(double sum, std::size_t n) {
+  if (sum != double(n) * (n - 1) / 2)
+    std::cerr << "wrong sum" << std::endl;
+}
+
+void bench(const std::string& name, const pool_type& pool,
+           const std::vector<stack_type>& heads) {
+  timer<> t;
+  const auto n = pool.psize();
+  double sum = 0;
+
+  print(name, "iterator", n);
+  t.start();
+  for (auto h : heads)
+    for (auto it = pool.cbegin(h); it != pool.cend(h); ++it)
+      sum += *it;
+  t.stop();
+  check(sum, n);
+
+  sum = 0;
+  print(name, "prefetch iterator", n);
+  t.start();
+  for (auto h : heads)
+    for (auto it = pool.pbegin(h); it != pool.pend(h); ++it)
+      sum += *it;
+  t.stop();
+  check(sum, n);
+
+  sum = 0;
+  print(name, "for_each", n);
+  t.start();
+  for (auto h : heads)
+    pool.for_each(h, [&sum](double v) { sum += v; });
+  t.stop();
+  check(sum, n);
+
+  sum = 0;
+  print(name, "lockstep, 8", n);
+  t.start();
+  pool.for_each_lockstep<8>(heads.begin(), heads.end(),
+                            [&sum](std::size_t, double v) { sum += v; });
+  t.stop();
+  check(sum, n);
+
+  sum = 0;
+  print(name, "lockstep, 32", n);
+  t.start();
+  pool.for_each_lockstep<32>(heads.begin(), heads.end(),
+                             [&sum](std::size_t, double v) { sum += v; });
+  t.stop();
+  check(sum, n);
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t n = 1 << 24;
+  std::size_t n_stacks = 1 << 10;
+  if (argc > 1)
+    n = std::atol(argv[1]);
+  if (argc > 2)
+    n_stacks = std::atol(argv[2]);
+
+  pool_type pool{n};
+  std::vector<stack_type> heads(n_stacks);
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<std::size_t> which{0, n_stacks - 1};
+  for (std::size_t i = 0; i < n; ++i) {
+    auto& h = heads[which(gen)];
+    h = pool.push(double(i), h);
+  }
+
+  std::cout << std::setw(12) << "pool" << std::setw(22) << "traversal"
+            << std::setw(12) << "nodes" << std::endl;
+  bench("shuffled", pool, heads);
+  heads = pool.compact(heads);
+  bench("compacted", pool, heads);
+}
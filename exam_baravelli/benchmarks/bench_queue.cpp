@@ -0,0 +1,102 @@
+#include "queue_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+// Many live queues: `queues` queues get `ops` operations on random queues,
+// two push_back for each pop_front, then every queue is drained.
+//  - std::queue: one std::queue<int> (on a std::deque) per queue
+//  - queue_pool: all the queues in one queue_pool<int, uint32_t>
+// Time of the creation of the empty queues, of the random operations and of
+// the drain, then checksum of the values popped.
+//
+// usage: ./bench_queue.x [queues] [ops]
+
+using stack_type = std::uint32_t;
+
+int main(int argc, char* argv[]) {
+  std::size_t queues = 100000;
+  std::size_t ops = 10000000;
+  if (argc > 1)
+    queues = std::atol(argv[1]);
+  if (argc > 2)
+    ops = std::atol(argv[2]);
+
+  // the same sequence of operations for both: queue index, pop if odd
+  std::vector<std::uint32_t> seq(ops);
+  std::mt19937 gen{42};
+  for (auto& s : seq)
+    s = (gen() % queues) << 1 | (gen() % 3 == 0);
+
+  timer<> t;
+  std::cout << std::setw(12) << "queue" << std::setw(12) << "phase"
+            << std::endl;
+  {
+    std::cout << std::setw(12) << "std::queue" << std::setw(12) << "create"
+              << "\t";
+    t.start();
+    std::vector<std::queue<int>> qs(queues);
+    t.stop();
+    long long sum = 0;
+
+    std::cout << std::setw(24) << "ops" << "\t";
+    t.start();
+    for (std::size_t i = 0; i < ops; ++i) {
+      auto& q = qs[seq[i] >> 1];
+      if (seq[i] & 1) {
+        if (!q.empty()) {
+          sum += q.front();
+          q.pop();
+        }
+      } else {
+        q.push(int(i));
+      }
+    }
+    t.stop();
+    std::cout << std::setw(24) << "drain" << "\t";
+    t.start();
+    for (auto& q : qs)
+      for (; !q.empty(); q.pop())
+        sum += q.front();
+    t.stop();
+    std::cout << std::setw(24) << sum << "\t[checksum]" << std::endl;
+  }
+  {
+    std::cout << std::setw(12) << "queue_pool" << std::setw(12) << "create"
+              << "\t";
+    t.start();
+    queue_pool<int, stack_type> pool{};
+    std::vector<queue_pool<int, stack_type>::queue> qs(queues,
+                                                       pool.new_queue());
+    t.stop();
+    long long sum = 0;
+
+    std::cout << std::setw(24) << "ops" << "\t";
+    t.start();
+    for (std::size_t i = 0; i < ops; ++i) {
+      auto& q = qs[seq[i] >> 1];
+      if (seq[i] & 1) {
+        if (!pool.empty(q)) {
+          sum += pool.front(q);
+          q = pool.pop_front(q);
+        }
+      } else {
+        q = pool.push_back(int(i), q);
+      }
+    }
+    t.stop();
+    std::cout << std::setw(24) << "drain" << "\t";
+    t.start();
+    for (auto& q : qs)
+      for (; !pool.empty(q); q = pool.pop_front(q))
+        sum += pool.front(q);
+    t.stop();
+    std::cout << std::setw(24) << sum << "\t[checksum]" << std::endl;
+    std::cout << std::setw(24) << pool.psize() << "\t[nodes]" << std::endl;
+  }
+}
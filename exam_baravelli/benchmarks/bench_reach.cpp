@@ -0,0 +1,87 @@
+#include "indexed_pool.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Random access into one long stack: reach() of stack_pool, a walk of m
+// nodes, against reach() of indexed_pool, O(log m) through the jump index.
+//  - push: builds the stack (the index costs one entry per push)
+//  - reach: queries at random depths (fewer for the plain walk)
+//  - rebuild: first query after an invalidate(), a full walk of the stack
+//
+// usage: ./bench_reach.x [nodes] [queries]
+
+using stack_type = std::uint32_t;
+
+template <typename P>
+void bench(const std::string& name, std::size_t n, std::size_t queries) {
+  timer<> t;
+  P pool{n};
+  auto l = pool.new_stack();
+
+  std::cout << std::setw(10) << name << std::setw(12) << n << std::setw(10)
+            << "push" << "\t";
+  t.start();
+  for (std::size_t i = 0; i < n; ++i)
+    l = pool.push(double(i), l);
+  t.stop();
+
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<stack_type> depth{1, stack_type(n)};
+  std::vector<stack_type> ms(queries);
+  for (auto& m : ms)
+    m = depth(gen);
+
+  std::cout << std::setw(10) << name << std::setw(12) << queries
+            << std::setw(10) << "reach" << "\t";
+  double sum = 0;
+  t.start();
+  for (auto m : ms)
+    sum += pool.reach(l, m);
+  t.stop();
+  double expected = 0;
+  for (auto m : ms)
+    expected += double(n - m);
+  if (sum != expected)
+    std::cerr << "wrong sum" << std::endl;
+}
+
+void rebuild(std::size_t n) {
+  timer<> t;
+  indexed_pool<double, stack_type> pool{n};
+  auto l = pool.new_stack();
+  for (std::size_t i = 0; i < n; ++i)
+    l = pool.push(double(i), l);
+  pool.invalidate();
+  std::cout << std::setw(10) << "indexed" << std::setw(12) << 1
+            << std::setw(10) << "rebuild" << "\t";
+  t.start();
+  const auto v = pool.reach(l, stack_type(n));
+  t.stop();
+  if (v != 0)
+    std::cerr << "wrong value" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t nodes = 10000000;
+  std::size_t queries = 1000000;
+  if (argc > 1)
+    nodes = std::atol(argv[1]);
+  if (argc > 2)
+    queries = std::atol(argv[2]);
+
+  std::cout << std::setw(10) << "pool" << std::setw(12) << "count"
+            << std::setw(10) << "operation" << std::endl;
+  // a plain walk is O(n) per query: keep the total time reasonable
+  bench<stack_pool<double, stack_type>>("plain", nodes,
+                                        std::max<std::size_t>(1, queries / 10000));
+  bench<indexed_pool<double, stack_type>>("indexed", nodes, queries);
+  rebuild(nodes);
+}
@@ -0,0 +1,62 @@
+#include "pool_allocator.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+
+// The std::set construction of count_operations/test_time.cpp, with the
+// nodes from std::allocator and from pool_allocator: for n doubling from 16,
+// a std::set is built from n shuffled values masked to [0, 8191].
+// Best time of a few constructions (destruction included) and speedup of
+// the pool. At most 8192 values are distinct, so from n = 8192 on the set
+// does not grow and most of the time goes into finding duplicates.
+//
+// usage: ./bench_set_alloc.x [max_n]
+
+template <typename Alloc, typename I>
+double set_timed(I first, I last, int reps) {
+  using value_type = typename std::iterator_traits<I>::value_type;
+  timer<> t;
+  double best = 0;
+  for (int r = 0; r < reps; ++r) {
+    t.start();
+    {
+      std::set<value_type, std::less<value_type>, Alloc> set{first, last};
+    }
+    best = r == 0 ? t.elapsed() : std::min(best, t.elapsed());
+  }
+  return best;
+}
+
+int main(int argc, char* argv[]) {
+  using value_type = int;
+  std::size_t max_n = std::size_t(1) << 25;
+  if (argc > 1)
+    max_n = std::atol(argv[1]);
+
+  std::mt19937 gen{42};
+  std::cout << std::setw(15) << "n" << std::setw(15) << "std::allocator"
+            << std::setw(15) << "pool" << std::setw(12) << "speedup"
+            << std::endl;
+  for (std::size_t n = 16; n < max_n; n <<= 1) {
+    std::vector<value_type> v(n);
+    std::iota(v.begin(), v.end(), value_type(-1024));
+    std::shuffle(v.begin(), v.end(), gen);
+    for (std::size_t i = 0; i < n; ++i) {
+      v[i] = int{v[i]} & 8191;
+    }
+    const int reps = std::max<std::size_t>(3, (std::size_t(1) << 16) / n);
+    const auto plain =
+        set_timed<std::allocator<value_type>>(v.begin(), v.end(), reps);
+    const auto pooled =
+        set_timed<pool_allocator<value_type>>(v.begin(), v.end(), reps);
+    std::cout << std::setw(15) << n << std::setw(15) << plain << std::setw(15)
+              << pooled << std::setw(12) << plain / pooled << std::endl;
+  }
+}
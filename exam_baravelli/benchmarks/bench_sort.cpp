@@ -0,0 +1,66 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Sorting a stack of n random values:
+//  - copy: the values are copied to a vector, sorted with std::stable_sort
+//    and pushed back with push_range, twice the memory of the stack
+//  - sort_stack: bottom-up merge sort relinking the nodes, no allocation
+// The nodes are pushed round robin on 4 stacks, as in a used pool.
+//
+// usage: ./bench_sort.x [max_nodes]
+
+using stack_type = std::uint32_t;
+constexpr int n_stacks = 4;
+
+void print(const std::string& name, std::size_t n) {
+  std::cout << std::setw(15) << name << std::setw(12) << n << "\t";
+}
+
+template <typename F>
+void bench(const std::string& name, std::size_t n, F sort) {
+  timer<> t;
+  std::mt19937 gen{42};
+  std::uniform_real_distribution<double> value{0, 1};
+  stack_pool<double, stack_type> pool{};
+  std::vector<stack_type> heads(n_stacks);
+  for (std::size_t i = 0; i < n; ++i)
+    heads[i % n_stacks] = pool.push(value(gen), heads[i % n_stacks]);
+
+  print(name, n);
+  t.start();
+  for (auto& h : heads)
+    h = sort(pool, h);
+  t.stop();
+  for (auto h : heads)
+    if (!std::is_sorted(pool.cbegin(h), pool.cend(h)))
+      std::cerr << "not sorted" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t max_nodes = 1 << 22;
+  if (argc > 1)
+    max_nodes = std::atol(argv[1]);
+
+  std::cout << std::setw(15) << "sort" << std::setw(12) << "nodes"
+            << std::endl;
+  for (std::size_t n = 1 << 12; n <= max_nodes; n <<= 2) {
+    bench("copy", n, [](stack_pool<double, stack_type>& pool, stack_type h) {
+      std::vector<double> values(pool.cbegin(h), pool.cend(h));
+      std::stable_sort(values.begin(), values.end(), std::greater<double>{});
+      h = pool.free_stack(h);
+      return pool.push_range(values.begin(), values.end(), h);
+    });
+    bench("sort_stack", n,
+          [](stack_pool<double, stack_type>& pool, stack_type h) {
+            return pool.sort_stack(h);
+          });
+  }
+}
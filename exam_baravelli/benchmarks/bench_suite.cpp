@@ -0,0 +1,258 @@
+#include "instrumented.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <forward_list>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <stack>
+#include <string>
+#include <vector>
+
+// Benchmark suite: stack_pool against one std::stack<T, std::vector<T>>,
+// std::forward_list<T> or std::pmr::forward_list<T> (on an
+// unsynchronized_pool_resource) per stack.
+// Scenarios, each on n nodes:
+//  - push: n pushes round robin on 64 stacks
+//  - pop: n pops round robin from 64 full stacks
+//  - churn: n random pushes (60%) and pops (40%) on 1024 stacks, half full
+//  - traverse: sum of all the values of 64 interleaved stacks
+//  - free_storm: 4 rounds of filling 1024 stacks of random length with n
+//    nodes and freeing them all
+// The sizes double from 1024 up to max_nodes. Each row reports the time of a
+// run with int values and the copies, moves and destructions counted by a
+// second run with instrumented<int>. Needs C++17 for std::pmr.
+// The output is CSV, `make csv` writes it to bench_suite.csv
+//
+// usage: ./bench_suite.x [max_nodes]
+
+using stack_type = std::uint32_t;
+
+long value_of(int x) {
+  return x;
+}
+long value_of(const instrumented<int>& x) {
+  return x.value;
+}
+
+template <typename V, typename C>
+class pool_stacks {
+  stack_pool<V, stack_type, aos_layout, C> pool;
+  std::vector<stack_type> heads;
+
+ public:
+  explicit pool_stacks(std::size_t s) : heads(s, pool.new_stack()) {}
+  void push(std::size_t k, V&& v) { heads[k] = pool.push(std::move(v), heads[k]); }
+  void pop(std::size_t k) { heads[k] = pool.pop(heads[k]); }
+  bool empty(std::size_t k) const { return pool.empty(heads[k]); }
+  void clear(std::size_t k) { heads[k] = pool.free_stack(heads[k]); }
+  long sum(std::size_t k) const {
+    long s = 0;
+    for (auto it = pool.cbegin(heads[k]); it != pool.cend(heads[k]); ++it)
+      s += value_of(*it);
+    return s;
+  }
+};
+
+template <typename V>
+class vector_stacks {
+  // std::stack does not let us walk it, its container is protected
+  struct walkable : std::stack<V, std::vector<V>> {
+    using std::stack<V, std::vector<V>>::c;
+  };
+  std::vector<walkable> stacks;
+
+ public:
+  explicit vector_stacks(std::size_t s) : stacks(s) {}
+  void push(std::size_t k, V&& v) { stacks[k].push(std::move(v)); }
+  void pop(std::size_t k) { stacks[k].pop(); }
+  bool empty(std::size_t k) const { return stacks[k].empty(); }
+  void clear(std::size_t k) { stacks[k].c.clear(); }
+  long sum(std::size_t k) const {
+    long s = 0;
+    for (const auto& x : stacks[k].c)
+      s += value_of(x);
+    return s;
+  }
+};
+
+template <typename V, typename List>
+class list_stacks {
+ protected:
+  std::vector<List> lists;
+
+ public:
+  list_stacks() = default;
+  explicit list_stacks(std::size_t s) : lists(s) {}
+  void push(std::size_t k, V&& v) { lists[k].push_front(std::move(v)); }
+  void pop(std::size_t k) { lists[k].pop_front(); }
+  bool empty(std::size_t k) const { return lists[k].empty(); }
+  void clear(std::size_t k) { lists[k].clear(); }
+  long sum(std::size_t k) const {
+    long s = 0;
+    for (const auto& x : lists[k])
+      s += value_of(x);
+    return s;
+  }
+};
+
+template <typename V>
+using forward_list_stacks = list_stacks<V, std::forward_list<V>>;
+
+template <typename V>
+class pmr_list_stacks : public list_stacks<V, std::pmr::forward_list<V>> {
+  std::pmr::unsynchronized_pool_resource resource;
+
+ public:
+  explicit pmr_list_stacks(std::size_t s) {
+    this->lists.reserve(s);
+    for (std::size_t i = 0; i < s; ++i)
+      this->lists.emplace_back(&resource);
+  }
+  // the lists must die before their resource
+  ~pmr_list_stacks() { this->lists.clear(); }
+};
+
+/** Measure of a run: time with a timer, copies and moves with instrumented.
+ */
+struct time_probe {
+  timer<> t;
+  double seconds{0};
+  void start() { t.start(); }
+  void stop() { seconds = t.elapsed(); }
+};
+
+struct count_probe {
+  double counts[instrumented_base::n_ops]{};
+  void start() { instrumented_base::initialize(0); }
+  void stop() {
+    std::copy(instrumented_base::counts,
+              instrumented_base::counts + instrumented_base::n_ops, counts);
+  }
+};
+
+// to keep the compiler from dropping the traversals
+volatile long sink;
+
+template <typename S, typename V, typename P>
+void push_heavy(std::size_t n, P& probe) {
+  S c{64};
+  probe.start();
+  for (std::size_t i = 0; i < n; ++i)
+    c.push(i % 64, V(int(i)));
+  probe.stop();
+}
+
+template <typename S, typename V, typename P>
+void pop_heavy(std::size_t n, P& probe) {
+  S c{64};
+  for (std::size_t i = 0; i < n; ++i)
+    c.push(i % 64, V(int(i)));
+  probe.start();
+  for (std::size_t i = 0; i < n; ++i)
+    c.pop(i % 64);
+  probe.stop();
+}
+
+template <typename S, typename V, typename P>
+void churn(std::size_t n, P& probe) {
+  constexpr std::size_t s = 1024;
+  std::mt19937 gen{42};
+  std::vector<std::uint32_t> dice(n);
+  for (auto& d : dice)
+    d = gen();
+  S c{s};
+  for (std::size_t i = 0; i < n / 2; ++i)
+    c.push(dice[i] % s, V(int(i)));
+  probe.start();
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto k = dice[i] % s;
+    if ((dice[i] >> 16) % 5 < 3 || c.empty(k))
+      c.push(k, V(int(i)));
+    else
+      c.pop(k);
+  }
+  probe.stop();
+}
+
+template <typename S, typename V, typename P>
+void traverse(std::size_t n, P& probe) {
+  S c{64};
+  for (std::size_t i = 0; i < n; ++i)
+    c.push(i % 64, V(int(i)));
+  probe.start();
+  long total = 0;
+  for (std::size_t k = 0; k < 64; ++k)
+    total += c.sum(k);
+  probe.stop();
+  sink = total;
+}
+
+template <typename S, typename V, typename P>
+void free_storm(std::size_t n, P& probe) {
+  constexpr std::size_t s = 1024;
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<std::size_t> length{1, 2 * n / s + 1};
+  S c{s};
+  probe.start();
+  for (int round = 0; round < 4; ++round) {
+    for (std::size_t pushed = 0, k = 0; pushed < n; k = (k + 1) % s)
+      for (auto l = length(gen); l > 0 && pushed < n; --l, ++pushed)
+        c.push(k, V(int(pushed)));
+    for (std::size_t k = 0; k < s; ++k)
+      c.clear(k);
+  }
+  probe.stop();
+}
+
+template <template <typename> class S>
+void run(const std::string& container, std::size_t n) {
+  using counted = instrumented<int>;
+  auto row = [&](const char* scenario, auto time_run, auto count_run) {
+    time_probe t;
+    count_probe c;
+    time_run(n, t);
+    count_run(n, c);
+    std::cout << container << ',' << scenario << ',' << n << ','
+              << t.seconds;
+    for (auto op : {instrumented_base::copy_ctor, instrumented_base::copy_assign,
+                    instrumented_base::move_ctor, instrumented_base::move_assign,
+                    instrumented_base::dtor})
+      std::cout << ',' << c.counts[op];
+    std::cout << '\n';
+  };
+  row("push", push_heavy<S<int>, int, time_probe>,
+      push_heavy<S<counted>, counted, count_probe>);
+  row("pop", pop_heavy<S<int>, int, time_probe>,
+      pop_heavy<S<counted>, counted, count_probe>);
+  row("churn", churn<S<int>, int, time_probe>,
+      churn<S<counted>, counted, count_probe>);
+  row("traverse", traverse<S<int>, int, time_probe>,
+      traverse<S<counted>, counted, count_probe>);
+  row("free_storm", free_storm<S<int>, int, time_probe>,
+      free_storm<S<counted>, counted, count_probe>);
+}
+
+template <typename V>
+using checked_pool = pool_stacks<V, checked>;
+template <typename V>
+using unchecked_pool = pool_stacks<V, unchecked>;
+
+int main(int argc, char* argv[]) {
+  std::size_t max_nodes = 1 << 22;
+  if (argc > 1)
+    max_nodes = std::atol(argv[1]);
+
+  std::cout << "container,scenario,nodes,seconds,copy_ctor,copy_assign,"
+               "move_ctor,move_assign,dtor\n";
+  for (std::size_t n = 1 << 10; n <= max_nodes; n <<= 1) {
+    run<checked_pool>("stack_pool", n);
+    run<unchecked_pool>("stack_pool_unchecked", n);
+    run<vector_stacks>("std::stack<vector>", n);
+    run<forward_list_stacks>("std::forward_list", n);
+    run<pmr_list_stacks>("std::pmr::forward_list", n);
+    std::cout << std::flush;
+  }
+}
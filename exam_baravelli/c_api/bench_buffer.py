@@ -0,0 +1,51 @@
+# /usr/bin/env python3
+
+# Reading a stack of n/2 doubles from Python, in a pool of n (10M by default):
+#  - per element: value() and next() through ctypes, two calls per node
+#  - to_array: a single call copying the stack into a (c_double * n) array
+#  - view: a zero-copy memoryview on the compacted stack
+# then summing the values read (sum() over the Python object).
+#
+# usage: python3 bench_buffer.py [n]   (after make)
+
+import sys
+import time
+from stackpool import Pool
+
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 10000000
+
+
+def timed(name, f):
+    start = time.perf_counter()
+    result = f()
+    print(f"{name:>25} {n:>10}\t{time.perf_counter() - start:>12.6f} [seconds]")
+    return result
+
+
+def per_element(pool, head):
+    out = []
+    while head != 0:
+        out.append(pool.value(head))
+        head = pool.next(head)
+    return out
+
+
+pool = Pool("f64", n)
+# two stacks, pushed bottom first: the head of each is at its highest index,
+# so they are contiguous only after compact()
+heads = [0, 0]
+half = (n + 1) // 2
+heads[0] = pool.push_many([float(i) for i in range(half)])
+heads[1] = pool.push_many([float(i) for i in range(n - half)])
+heads[0] = pool.push(-1.0, heads[0])
+heads[1] = pool.pop(heads[1])
+expected = sum(range(half)) - 1.0
+
+values = timed("per element", lambda: per_element(pool, heads[0]))
+assert timed("  sum", lambda: sum(values)) == expected
+values = timed("to_array", lambda: pool.to_array(heads[0]))
+assert timed("  sum", lambda: sum(values)) == expected
+heads = timed("compact", lambda: pool.compact(heads))
+values = timed("view", lambda: pool.view(heads[0]))
+assert timed("  sum", lambda: sum(values)) == expected
+assert values[0] == -1.0 and values[-1] == 0.0 and len(values) == half + 1
@@ -0,0 +1,81 @@
+# /usr/bin/env python3
+
+# Smoke benchmark of the C interface of stack_pool from Python, through ctypes:
+# n values pushed, copied out and popped one call at a time, against a single
+# batch call for each operation.
+#
+# usage: python3 bench_ctypes.py [n]   (after make)
+
+import sys
+import time
+from ctypes import *
+
+dso = CDLL("./libstack_pool_c.so")
+
+pool_p = c_void_p
+dso.sp_last_error.restype = c_char_p
+dso.sp_f64_create.argtypes = [c_size_t]
+dso.sp_f64_create.restype = pool_p
+dso.sp_f64_destroy.argtypes = [pool_p]
+dso.sp_f64_push.argtypes = [pool_p, c_double, c_uint32, POINTER(c_uint32)]
+dso.sp_f64_pop.argtypes = [pool_p, c_uint32, POINTER(c_uint32)]
+dso.sp_f64_value.argtypes = [pool_p, c_uint32, POINTER(c_double)]
+dso.sp_f64_push_many.argtypes = [pool_p, POINTER(c_double), c_size_t, c_uint32, POINTER(c_uint32)]
+dso.sp_f64_pop_many.argtypes = [pool_p, c_uint32, POINTER(c_double), c_size_t, POINTER(c_size_t), POINTER(c_uint32)]
+dso.sp_f64_copy_out.argtypes = [pool_p, c_uint32, POINTER(c_double), c_size_t, POINTER(c_size_t)]
+
+
+def check(status):
+    if status != 0:
+        raise RuntimeError(dso.sp_last_error().decode())
+
+
+def timed(name, n, f):
+    start = time.perf_counter()
+    result = f()
+    print(f"{name:>25} {n:>10}\t{time.perf_counter() - start:>12.6f} [seconds]")
+    return result
+
+
+def one_at_a_time(pool, values):
+    head = c_uint32(0)
+    for v in values:
+        check(dso.sp_f64_push(pool, v, head, byref(head)))
+    out = []
+    x = c_double()
+    h = head.value
+    while h != 0:
+        check(dso.sp_f64_value(pool, h, byref(x)))
+        out.append(x.value)
+        check(dso.sp_f64_pop(pool, h, byref(head)))
+        h = head.value
+    return out
+
+
+def batched(pool, array, n):
+    head = c_uint32(0)
+    check(dso.sp_f64_push_many(pool, array, n, 0, byref(head)))
+    copy = (c_double * n)()
+    length = c_size_t()
+    check(dso.sp_f64_copy_out(pool, head, copy, n, byref(length)))
+    out = (c_double * n)()
+    popped = c_size_t()
+    check(dso.sp_f64_pop_many(pool, head, out, n, byref(popped), byref(head)))
+    assert length.value == n and popped.value == n and head.value == 0
+    return out
+
+
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 1000000
+values = [float(i) for i in range(n)]
+array = (c_double * n)(*values)  # better do the allocation on the python side
+
+pool = dso.sp_f64_create(n)
+out = timed("one call per value", n, lambda: one_at_a_time(pool, values))
+assert out[0] == n - 1 and out[-1] == 0
+out = timed("batch calls", n, lambda: batched(pool, array, n))
+assert out[0] == n - 1 and out[n - 1] == 0
+
+head = c_uint32(0)
+assert dso.sp_f64_pop(pool, 0, byref(head)) != 0
+print("expected error:", dso.sp_last_error().decode().strip())
+dso.sp_f64_destroy(pool)
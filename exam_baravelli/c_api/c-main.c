@@ -0,0 +1,67 @@
+#include "stack_pool_c.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* smoke test of the C interface, run by make check */
+
+#define CHECK(cond)                                           \
+  do {                                                        \
+    if (!(cond)) {                                            \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      return 1;                                               \
+    }                                                         \
+  } while (0)
+
+int main() {
+  sp_i64_pool p = sp_i64_create(16);
+  uint32_t l = 0;
+  int64_t v = 0;
+  size_t n = 0;
+  CHECK(p != NULL);
+
+  CHECK(sp_i64_push(p, 42, l, &l) == SP_OK);
+  CHECK(l == 1);
+  CHECK(sp_i64_value(p, l, &v) == SP_OK && v == 42);
+  CHECK(sp_i64_pop(p, l, &l) == SP_OK && l == 0);
+  CHECK(sp_i64_pop(p, l, &l) == SP_ERROR);
+  printf("expected error:\n%s", sp_last_error());
+  CHECK(sp_i64_value(p, 100, &v) == SP_ERROR);
+
+  int64_t values[5] = {1, 2, 3, 4, 5};
+  CHECK(sp_i64_push_many(p, values, 5, l, &l) == SP_OK);
+  CHECK(sp_i64_ssize(p, l, &n) == SP_OK && n == 5);
+
+  int64_t out[8] = {0};
+  CHECK(sp_i64_copy_out(p, l, out, 3, &n) == SP_OK && n == 5);
+  CHECK(out[0] == 5 && out[2] == 3 && out[3] == 0);
+
+  size_t popped = 0;
+  CHECK(sp_i64_pop_many(p, l, out, 8, &popped, &l) == SP_OK);
+  CHECK(popped == 5 && l == 0 && out[4] == 1);
+  CHECK(sp_i64_psize(p) == 5);
+  sp_i64_destroy(p);
+
+  sp_f64_pool q = sp_f64_create(0);
+  double d[3] = {0.5, 1.5, 2.5};
+  double x = 0;
+  CHECK(sp_f64_push_many(q, d, 3, 0, &l) == SP_OK);
+  CHECK(sp_f64_value(q, l, &x) == SP_OK && x == 2.5);
+  CHECK(sp_f64_free_stack(q, l) == SP_OK);
+  CHECK(sp_f64_push(q, 7.0, 0, &l) == SP_OK && l != 0);
+  CHECK(sp_f64_psize(q) == 3);
+
+  /* the new stack takes the free nodes 2 and 1, then the new node 4 */
+  uint32_t heads[2] = {l, 0};
+  const double* view = NULL;
+  CHECK(sp_f64_push_many(q, d, 3, 0, &heads[1]) == SP_OK);
+  CHECK(sp_f64_view(q, heads[1], &view, &n) == SP_ERROR);
+  CHECK(sp_f64_compact(q, heads, 2) == SP_OK);
+  CHECK(heads[0] == 1 && heads[1] == 2);
+  CHECK(sp_f64_view(q, heads[1], &view, &n) == SP_OK && n == 3);
+  CHECK(view[0] == 2.5 && view[1] == 1.5 && view[2] == 0.5);
+  CHECK(sp_f64_view(q, 0, &view, &n) == SP_OK && n == 0);
+  sp_f64_destroy(q);
+
+  printf("hello from c! the C interface of stack_pool works\n");
+  return 0;
+}
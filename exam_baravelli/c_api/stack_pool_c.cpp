@@ -0,0 +1,231 @@
+#include "stack_pool_c.h"
+#include "stack_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <string>
+#include <vector>
+
+// The functions of the two pools are generated from the templates below:
+// each C function casts the opaque handle back and runs its body through
+// guarded(), so that no exception crosses the C boundary.
+
+namespace {
+
+template <typename T>
+using pool_c = stack_pool<T, std::uint32_t, soa_layout>;
+
+thread_local std::string last_error;
+
+template <typename F>
+int guarded(F f) noexcept {
+  try {
+    f();
+    return SP_OK;
+  } catch (const std::exception& e) {
+    last_error = e.what();
+  } catch (...) {
+    last_error = "unknown error";
+  }
+  return SP_ERROR;
+}
+
+template <typename T>
+pool_c<T>& pool(void* p) {
+  AP_ERROR(p != nullptr) << "null pool\n";
+  return *static_cast<pool_c<T>*>(p);
+}
+
+template <typename T>
+void* create(std::size_t n) noexcept {
+  void* p = nullptr;
+  guarded([&] { p = new pool_c<T>{n}; });
+  return p;
+}
+
+// output iterator writing to an array and counting the values written
+template <typename T>
+struct counting_writer {
+  T* p;
+  std::size_t* count;
+  counting_writer& operator*() { return *this; }
+  counting_writer& operator=(T v) {
+    *p = v;
+    return *this;
+  }
+  counting_writer& operator++() {
+    ++p;
+    ++*count;
+    return *this;
+  }
+};
+
+template <typename T>
+int push_many(void* p, const T* values, std::size_t n, std::uint32_t head,
+              std::uint32_t* new_head) noexcept {
+  return guarded([&] {
+    AP_ERROR(values != nullptr || n == 0) << "null values\n";
+    *new_head = pool<T>(p).push_range(values, values + n, head);
+  });
+}
+
+template <typename T>
+int pop_many(void* p, std::uint32_t head, T* out, std::size_t n,
+             std::size_t* popped, std::uint32_t* new_head) noexcept {
+  return guarded([&] {
+    AP_ERROR(out != nullptr || n == 0) << "null output\n";
+    *popped = 0;
+    *new_head = pool<T>(p).pop_n(head, n, counting_writer<T>{out, popped});
+  });
+}
+
+template <typename T>
+int copy_out(void* p, std::uint32_t head, T* out, std::size_t capacity,
+             std::size_t* length) noexcept {
+  return guarded([&] {
+    AP_ERROR(out != nullptr || capacity == 0) << "null output\n";
+    std::size_t i = 0;
+    pool<T>(p).for_each(head, [&](const T& v) {
+      if (i < capacity)
+        out[i] = v;
+      ++i;
+    });
+    *length = i;
+  });
+}
+
+template <typename T>
+int compact(void* p, std::uint32_t* heads, std::size_t n) noexcept {
+  return guarded([&] {
+    AP_ERROR(heads != nullptr || n == 0) << "null heads\n";
+    const auto h = pool<T>(p).compact(std::vector<std::uint32_t>(heads, heads + n));
+    std::copy(h.begin(), h.end(), heads);
+  });
+}
+
+// a compacted stack is the run of nodes head, head+1, ... and soa_layout
+// keeps their values side by side
+template <typename T>
+int view(void* p, std::uint32_t head, const T** data,
+         std::size_t* length) noexcept {
+  return guarded([&] {
+    const auto& pl = pool<T>(p);
+    std::size_t n = 0;
+    for (auto x = head; !pl.empty(x); x = pl.next(x), ++n)
+      AP_ERROR(x == head + n) << "the stack is not a contiguous run of nodes, compact the pool first\n";
+    AP_ERROR(n < 2 || &pl.value(head + 1) == &pl.value(head) + 1)
+        << "the values are not contiguous in this layout\n";
+    *data = n > 0 ? &pl.value(head) : nullptr;
+    *length = n;
+  });
+}
+
+}  // namespace
+
+extern "C" {
+
+const char* sp_last_error(void) {
+  return last_error.c_str();
+}
+
+// int64_t
+
+sp_i64_pool sp_i64_create(size_t n) {
+  return create<std::int64_t>(n);
+}
+void sp_i64_destroy(sp_i64_pool p) {
+  delete static_cast<pool_c<std::int64_t>*>(p);
+}
+size_t sp_i64_psize(sp_i64_pool p) {
+  return p ? pool<std::int64_t>(p).psize() : 0;
+}
+int sp_i64_push(sp_i64_pool p, int64_t value, uint32_t head,
+                uint32_t* new_head) {
+  return guarded([&] { *new_head = pool<std::int64_t>(p).push(value, head); });
+}
+int sp_i64_pop(sp_i64_pool p, uint32_t head, uint32_t* new_head) {
+  return guarded([&] { *new_head = pool<std::int64_t>(p).pop(head); });
+}
+int sp_i64_value(sp_i64_pool p, uint32_t x, int64_t* value) {
+  return guarded([&] { *value = pool<std::int64_t>(p).value(x); });
+}
+int sp_i64_free_stack(sp_i64_pool p, uint32_t head) {
+  return guarded([&] { pool<std::int64_t>(p).free_stack(head); });
+}
+int sp_i64_ssize(sp_i64_pool p, uint32_t head, size_t* size) {
+  return guarded([&] { *size = pool<std::int64_t>(p).ssize(head); });
+}
+int sp_i64_next(sp_i64_pool p, uint32_t x, uint32_t* next) {
+  return guarded([&] { *next = pool<std::int64_t>(p).next(x); });
+}
+int sp_i64_push_many(sp_i64_pool p, const int64_t* values, size_t n,
+                     uint32_t head, uint32_t* new_head) {
+  return push_many(p, values, n, head, new_head);
+}
+int sp_i64_pop_many(sp_i64_pool p, uint32_t head, int64_t* out, size_t n,
+                    size_t* popped, uint32_t* new_head) {
+  return pop_many(p, head, out, n, popped, new_head);
+}
+int sp_i64_copy_out(sp_i64_pool p, uint32_t head, int64_t* out,
+                    size_t capacity, size_t* length) {
+  return copy_out(p, head, out, capacity, length);
+}
+int sp_i64_compact(sp_i64_pool p, uint32_t* heads, size_t n) {
+  return compact<std::int64_t>(p, heads, n);
+}
+int sp_i64_view(sp_i64_pool p, uint32_t head, const int64_t** data,
+                size_t* length) {
+  return view(p, head, data, length);
+}
+
+// double
+
+sp_f64_pool sp_f64_create(size_t n) {
+  return create<double>(n);
+}
+void sp_f64_destroy(sp_f64_pool p) {
+  delete static_cast<pool_c<double>*>(p);
+}
+size_t sp_f64_psize(sp_f64_pool p) {
+  return p ? pool<double>(p).psize() : 0;
+}
+int sp_f64_push(sp_f64_pool p, double value, uint32_t head,
+                uint32_t* new_head) {
+  return guarded([&] { *new_head = pool<double>(p).push(value, head); });
+}
+int sp_f64_pop(sp_f64_pool p, uint32_t head, uint32_t* new_head) {
+  return guarded([&] { *new_head = pool<double>(p).pop(head); });
+}
+int sp_f64_value(sp_f64_pool p, uint32_t x, double* value) {
+  return guarded([&] { *value = pool<double>(p).value(x); });
+}
+int sp_f64_free_stack(sp_f64_pool p, uint32_t head) {
+  return guarded([&] { pool<double>(p).free_stack(head); });
+}
+int sp_f64_ssize(sp_f64_pool p, uint32_t head, size_t* size) {
+  return guarded([&] { *size = pool<double>(p).ssize(head); });
+}
+int sp_f64_next(sp_f64_pool p, uint32_t x, uint32_t* next) {
+  return guarded([&] { *next = pool<double>(p).next(x); });
+}
+int sp_f64_push_many(sp_f64_pool p, const double* values, size_t n,
+                     uint32_t head, uint32_t* new_head) {
+  return push_many(p, values, n, head, new_head);
+}
+int sp_f64_pop_many(sp_f64_pool p, uint32_t head, double* out, size_t n,
+                    size_t* popped, uint32_t* new_head) {
+  return pop_many(p, head, out, n, popped, new_head);
+}
+int sp_f64_copy_out(sp_f64_pool p, uint32_t head, double* out,
+                    size_t capacity, size_t* length) {
+  return copy_out(p, head, out, capacity, length);
+}
+int sp_f64_compact(sp_f64_pool p, uint32_t* heads, size_t n) {
+  return compact<double>(p, heads, n);
+}
+int sp_f64_view(sp_f64_pool p, uint32_t head, const double** data,
+                size_t* length) {
+  return view(p, head, data, length);
+}
+}
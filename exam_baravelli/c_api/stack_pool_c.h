@@ -0,0 +1,85 @@
+#ifndef _STACK_POOL_C_H_
+#define _STACK_POOL_C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface of stack_pool<int64_t, uint32_t, soa_layout> (prefix sp_i64_)
+ * and stack_pool<double, uint32_t, soa_layout> (prefix sp_f64_), for C
+ * programs and FFI consumers such as Python ctypes. The values live in an
+ * array of their own, so that a compacted stack can be read in place.
+ *
+ * A pool is an opaque handle, stacks are uint32_t heads as in stack_pool:
+ * 0 is the empty stack. Every function that can fail returns SP_OK or
+ * SP_ERROR, and writes its results through pointers; the message of the
+ * last error of the calling thread is given by sp_last_error().
+ *
+ * Crossing the FFI boundary costs much more than a push: prefer the batch
+ * functions, which move a whole array in a single call, or read a
+ * compacted stack in place through view().
+ */
+
+typedef void* sp_i64_pool;
+typedef void* sp_f64_pool;
+
+#define SP_OK 0
+#define SP_ERROR -1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* message of the last error of the calling thread, "" if none */
+const char* sp_last_error(void);
+
+/* pool of int64_t values */
+
+/* NULL if the n reserved nodes cannot be allocated */
+sp_i64_pool sp_i64_create(size_t n);
+void sp_i64_destroy(sp_i64_pool);
+size_t sp_i64_psize(sp_i64_pool);
+
+int sp_i64_push(sp_i64_pool, int64_t value, uint32_t head, uint32_t* new_head);
+int sp_i64_pop(sp_i64_pool, uint32_t head, uint32_t* new_head);
+int sp_i64_value(sp_i64_pool, uint32_t x, int64_t* value);
+int sp_i64_free_stack(sp_i64_pool, uint32_t head);
+int sp_i64_ssize(sp_i64_pool, uint32_t head, size_t* size);
+int sp_i64_next(sp_i64_pool, uint32_t x, uint32_t* next);
+
+/* values[n-1] becomes the head, as if the values were pushed in order */
+int sp_i64_push_many(sp_i64_pool, const int64_t* values, size_t n, uint32_t head, uint32_t* new_head);
+/* pops up to n values into out, head first; *popped is how many. On failure no node is popped */
+int sp_i64_pop_many(sp_i64_pool, uint32_t head, int64_t* out, size_t n, size_t* popped, uint32_t* new_head);
+/* copies up to capacity values into out, head first, leaving the stack as it is; *length is the length of the stack */
+int sp_i64_copy_out(sp_i64_pool, uint32_t head, int64_t* out, size_t capacity, size_t* length);
+/* compacts the pool: the n heads must be all the live stacks, they are updated in place */
+int sp_i64_compact(sp_i64_pool, uint32_t* heads, size_t n);
+/* address of the values of a stack, head first, without copying: fails unless the stack is a contiguous
+   run (as after compact). Walks the indexes of the stack once; the address is valid until the pool changes */
+int sp_i64_view(sp_i64_pool, uint32_t head, const int64_t** data, size_t* length);
+
+/* pool of double values, same functions */
+
+sp_f64_pool sp_f64_create(size_t n);
+void sp_f64_destroy(sp_f64_pool);
+size_t sp_f64_psize(sp_f64_pool);
+
+int sp_f64_push(sp_f64_pool, double value, uint32_t head, uint32_t* new_head);
+int sp_f64_pop(sp_f64_pool, uint32_t head, uint32_t* new_head);
+int sp_f64_value(sp_f64_pool, uint32_t x, double* value);
+int sp_f64_free_stack(sp_f64_pool, uint32_t head);
+int sp_f64_ssize(sp_f64_pool, uint32_t head, size_t* size);
+int sp_f64_next(sp_f64_pool, uint32_t x, uint32_t* next);
+
+int sp_f64_push_many(sp_f64_pool, const double* values, size_t n, uint32_t head, uint32_t* new_head);
+int sp_f64_pop_many(sp_f64_pool, uint32_t head, double* out, size_t n, size_t* popped, uint32_t* new_head);
+int sp_f64_copy_out(sp_f64_pool, uint32_t head, double* out, size_t capacity, size_t* length);
+int sp_f64_compact(sp_f64_pool, uint32_t* heads, size_t n);
+int sp_f64_view(sp_f64_pool, uint32_t head, const double** data, size_t* length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STACK_POOL_C_H_ */
@@ -0,0 +1,136 @@
+# /usr/bin/env python3
+
+"""Python access to stack_pool, through the C interface of libstack_pool_c.so and ctypes.
+
+A Pool holds int64 ('i64') or float ('f64') values; stacks are int heads, 0 is the empty stack.
+A call through ctypes costs about a microsecond, so there are three ways to read a stack:
+ - value() and next(), one node per call: fine for a few nodes
+ - to_array(), the whole stack copied in one call into a ctypes array (c_double * n),
+   which can be given by the caller to reuse it
+ - view(), a read-only memoryview on the values of a compacted stack, without any copy:
+   after compact() each stack is a contiguous run, head first. The view is valid until
+   the pool changes (push, pop, compact, ...), reading it after that is undefined
+Errors of the library are raised as RuntimeError.
+"""
+
+import os
+from ctypes import *
+
+_dso = CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), "libstack_pool_c.so"))
+_dso.sp_last_error.restype = c_char_p
+
+_types = {"i64": c_int64, "f64": c_double}
+
+for _kind, _t in _types.items():
+
+    def _f(name, *argtypes, restype=c_int):
+        f = getattr(_dso, f"sp_{_kind}_{name}")
+        f.argtypes = list(argtypes)
+        f.restype = restype
+
+    _f("create", c_size_t, restype=c_void_p)
+    _f("destroy", c_void_p, restype=None)
+    _f("psize", c_void_p, restype=c_size_t)
+    _f("push", c_void_p, _t, c_uint32, POINTER(c_uint32))
+    _f("pop", c_void_p, c_uint32, POINTER(c_uint32))
+    _f("value", c_void_p, c_uint32, POINTER(_t))
+    _f("next", c_void_p, c_uint32, POINTER(c_uint32))
+    _f("free_stack", c_void_p, c_uint32)
+    _f("ssize", c_void_p, c_uint32, POINTER(c_size_t))
+    _f("push_many", c_void_p, POINTER(_t), c_size_t, c_uint32, POINTER(c_uint32))
+    _f("pop_many", c_void_p, c_uint32, POINTER(_t), c_size_t, POINTER(c_size_t), POINTER(c_uint32))
+    _f("copy_out", c_void_p, c_uint32, POINTER(_t), c_size_t, POINTER(c_size_t))
+    _f("compact", c_void_p, POINTER(c_uint32), c_size_t)
+    _f("view", c_void_p, c_uint32, POINTER(POINTER(_t)), POINTER(c_size_t))
+
+
+def _check(status):
+    if status != 0:
+        raise RuntimeError(_dso.sp_last_error().decode())
+
+
+class Pool:
+    def __init__(self, kind="f64", n=0):
+        self.type = _types[kind]
+        self._fn = lambda name: getattr(_dso, f"sp_{kind}_{name}")
+        self._p = self._fn("create")(n)
+        if not self._p:
+            raise RuntimeError(_dso.sp_last_error().decode())
+
+    def __del__(self):
+        if getattr(self, "_p", None):
+            self._fn("destroy")(self._p)
+            self._p = None
+
+    def psize(self):
+        return self._fn("psize")(self._p)
+
+    def _head(self, name, *args):
+        h = c_uint32()
+        _check(self._fn(name)(self._p, *args, byref(h)))
+        return h.value
+
+    def push(self, value, head=0):
+        return self._head("push", value, head)
+
+    def pop(self, head):
+        return self._head("pop", head)
+
+    def next(self, x):
+        return self._head("next", x)
+
+    def value(self, x):
+        v = self.type()
+        _check(self._fn("value")(self._p, x, byref(v)))
+        return v.value
+
+    def free_stack(self, head):
+        _check(self._fn("free_stack")(self._p, head))
+        return 0
+
+    def ssize(self, head):
+        n = c_size_t()
+        _check(self._fn("ssize")(self._p, head, byref(n)))
+        return n.value
+
+    def push_many(self, values, head=0):
+        """pushes the values in order, the last one becomes the head"""
+        if not isinstance(values, Array) or values._type_ is not self.type:
+            values = (self.type * len(values))(*values)
+        return self._head("push_many", values, len(values), head)
+
+    def pop_many(self, head, n):
+        """pops up to n values, returns them head first and the new head"""
+        out = (self.type * n)()
+        popped = c_size_t()
+        h = c_uint32()
+        _check(self._fn("pop_many")(self._p, head, out, n, byref(popped), byref(h)))
+        return out[: popped.value], h.value
+
+    def to_array(self, head, out=None):
+        """copies the values of a stack, head first, into a ctypes array (out, if large enough) in one call"""
+        if out is None:
+            out = (self.type * self.ssize(head))()
+        n = c_size_t()
+        _check(self._fn("copy_out")(self._p, head, out, len(out), byref(n)))
+        if n.value > len(out):
+            raise ValueError(f"the stack has {n.value} values, the array only {len(out)}")
+        return out
+
+    def compact(self, heads):
+        """compacts the pool, heads must be all the live stacks; returns the new heads in the same order"""
+        h = (c_uint32 * len(heads))(*heads)
+        _check(self._fn("compact")(self._p, h, len(h)))
+        return list(h)
+
+    def view(self, head):
+        """read-only memoryview on the values of a compacted stack, head first, without copying;
+        the view keeps the pool alive, and is valid until the pool changes"""
+        data = POINTER(self.type)()
+        n = c_size_t()
+        _check(self._fn("view")(self._p, head, byref(data), byref(n)))
+        if n.value == 0:
+            return memoryview((self.type * 0)()).toreadonly()
+        array = (self.type * n.value).from_address(addressof(data.contents))
+        array._pool = self  # the memory belongs to the pool: it must outlive the view
+        return memoryview(array).cast("B").cast(array._type_._type_).toreadonly()
@@ -0,0 +1,474 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include "stack_iterator.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file concurrent_stack_pool.hpp
+*	@brief Header file: implementation of class concurrent_stack_pool, the thread-safe sibling of stack_pool
+*/
+
+
+/**
+* Class \p concurrent_stack_pool: pool of stacks that can be used by many threads at the same time.
+*
+* The addressing scheme is the one of \p stack_pool: each node is identified by its position + 1,
+* so that 0 can be used as \p end(). What changes is how the two pieces of shared state are handled:
+* - the storage: nodes live in blocks of geometrically increasing size (block k holds 2^(k+first_block_bits) nodes),
+*   so the pool grows without ever moving a node. A reader holding a node index can keep using it while other
+*   threads make the pool grow. The block of an index is found with a count-leading-zeros and a mask.
+* - \p free_nodes: the head of the free list is an atomic 64 bit word, where the low 32 bits are the index
+*   and the high 32 bits are a generation tag bumped by every successful update. A thread that read
+*   the head, got preempted, and meanwhile saw the same index recycled will fail its compare-exchange
+*   because the tag changed, so the classic ABA problem of Treiber stacks cannot corrupt the free list.
+*
+* Two ways of using the pool are supported:
+* - private stacks: each thread pushes/pops on its own heads with the same interface of \p stack_pool.
+*   Different threads can work on different stacks at the same time, they only share the free list and the storage.
+* - shared stacks: a \p shared_stack is an atomic, tagged head that many threads push to and pop from (Treiber stack).
+*
+* Notice: pushing/popping the same plain head from two threads is still a data race, use a \p shared_stack for that. \n
+* The pool never gives memory back to the system before its destruction.
+* @tparam T type of the values carried by each node, must be default constructible
+* @tparam N stack/index type, an unsigned integral type of at most 32 bits (it has to fit next to the tag)
+*/
+template <typename T, typename N = std::uint32_t>
+class concurrent_stack_pool{
+
+  static_assert(std::is_unsigned<N>::value && sizeof(N) <= 4,
+                "concurrent_stack_pool needs an unsigned index type of at most 32 bits");
+
+  /** Class \p node_t, implementing the concept of node of a stack.
+  * \p next is atomic since a thread trying to pop from the free list may read it while
+  * the node is being reused by another thread (the read value is then discarded by the failing CAS).
+  */
+  struct node_t{
+    /** value of type T carried by the node */
+    T value{};
+
+    /** index to the next node, type N */
+    std::atomic<N> next{0};
+  };
+
+  using tagged_type = std::uint64_t; // index in the low half, generation tag in the high half
+
+  using value_type = T; // type of the values
+  using stack_type = N; // type of the stacks indexes
+  using size_type = std::size_t;
+  using pool_type = concurrent_stack_pool<value_type, stack_type>;
+
+  /** Base 2 logarithm of the number of nodes of the first block */
+  static constexpr unsigned first_block_bits = 10;
+
+  /** Number of blocks needed to address every index representable by N */
+  static constexpr std::size_t max_blocks = sizeof(N) * 8 - first_block_bits + 1;
+
+
+  /** Blocks of nodes, allocated on demand and never moved until the destruction of the pool. */
+  std::array<std::atomic<node_t*>, max_blocks> blocks;
+
+  /** Number of nodes ever handed out from the blocks (free nodes included). */
+  std::atomic<size_type> pool_size;
+
+  /** Tagged head of the stack of free nodes. */
+  std::atomic<tagged_type> free_nodes;
+
+
+ public:
+
+  /** Class \p shared_stack: head of a stack shared among threads.
+  * It is a tagged head, exactly like \p free_nodes, hence it can only be used
+  * through \p push(shared_stack&, ...) and \p try_pop(). It does not own its nodes:
+  * empty it before the destruction of the pool, or the nodes are simply lost until then.
+  */
+  class shared_stack{
+    friend class concurrent_stack_pool;
+    std::atomic<tagged_type> top{0};
+
+   public:
+    shared_stack() noexcept = default;
+    shared_stack(const shared_stack&) = delete;
+    shared_stack& operator=(const shared_stack&) = delete;
+  };
+
+
+  /**Default constructor, sets free_nodes as empty, no block is allocated. */
+  concurrent_stack_pool() noexcept
+    : pool_size{0},
+      free_nodes{0}{
+      for (auto& b : blocks)
+        b.store(nullptr, std::memory_order_relaxed);
+    }
+
+  /** Custom constructor, allocates the blocks needed to hold n nodes.
+  * @param n number of nodes to reserve
+  */
+  explicit concurrent_stack_pool(size_type n)
+    : concurrent_stack_pool()
+    {reserve(n);}
+
+  /** Copying or moving a pool other threads may be using makes no sense. */
+  concurrent_stack_pool(const concurrent_stack_pool&) = delete;
+  concurrent_stack_pool& operator=(const concurrent_stack_pool&) = delete;
+
+  /** Destructor, releases every block. No other thread must be using the pool. */
+  ~concurrent_stack_pool() noexcept{
+    for (auto& b : blocks)
+      delete[] b.load(std::memory_order_relaxed);
+  }
+
+
+
+  //____________Iterators_Domain___________________________________________//
+
+  using iterator = _stack_iterator<value_type, stack_type, pool_type>;
+  using const_iterator = _stack_iterator<const value_type, stack_type, const pool_type>;
+
+  /** Function providing the iterator to the first element of the (private) stack.
+  * @param x head of the stack
+  * @return iterator to the first element
+  */
+  iterator begin(stack_type x){
+    return iterator{x, this};
+    }
+
+  /** Function providing the iterator to the proxy last element of the stack.
+  * @return iterator to the proxy last element
+  */
+  iterator end(stack_type )noexcept{
+    return iterator{end(), this};
+    }
+
+  /** Overloaded begin function providing a const iterator to the first element of the stack.
+  * @param x head of the stack
+  * @return const iterator to the first element
+  */
+  const_iterator begin(stack_type x) const{
+    return const_iterator{x, this};
+    }
+
+  /** Overloaded end function providing a const iterator to the proxy last element of the stack.
+  * @return const iterator to the proxy last element
+  */
+  const_iterator end(stack_type ) const noexcept{
+    return const_iterator{end(), this};
+    }
+
+  /** Constant begin function providing a const iterator to the first element of the stack.
+  * @param x head of the stack
+  * @return const iterator to the first element
+  */
+  const_iterator cbegin(stack_type x) const{
+    return const_iterator{x, this};
+    }
+
+  /** Constant end function providing a const iterator to the proxy last element of the stack.
+  * @return const iterator to the proxy last element
+  */
+  const_iterator cend(stack_type ) const noexcept{
+    return const_iterator{end(), this};
+    }
+
+
+
+  //____________Get_To_Know_The_Pool______________________________________//
+
+  /** Function providing the proxy index of the end of the stacks.
+  * @return element 0 casted in the correct way to \p stack_type
+  */
+  stack_type end() const noexcept {
+     return stack_type(0);
+     }
+
+  /** Function providing the head of a new empty stack.
+  * @return head of the empty new stack which is always \p end()
+  */
+  stack_type new_stack() noexcept{
+    return end();
+  }
+
+  /** Function allowing to assess whether the given stack is empty or not.
+  * @return true if the stack is empty, false if it's not
+  */
+  bool empty(stack_type x) const noexcept{
+    return (x==end());
+  }
+
+  /** Function allowing to assess whether the given shared stack is empty or not.
+  * The answer may be outdated as soon as it is returned if other threads are using the stack.
+  * @return true if the stack is empty, false if it's not
+  */
+  bool empty(const shared_stack& s) const noexcept{
+    return empty(_index(s.top.load(std::memory_order_acquire)));
+  }
+
+  /** Function providing access to the node value at the given index.
+  * Throws if the given index has never been handed out by the pool.
+  * @param x index of a node
+  * @return reference to the value of the node identified by \p x
+  */
+  T& value(stack_type x){
+    AP_ERROR_IN_RANGE(x, stack_type(1), psize());
+    return node(x).value;
+  }
+
+  /** Constant function providing access to the node value at the given index.
+  * Throws if the given index has never been handed out by the pool.
+  * @param x index of a node
+  * @return constant reference to the value of the node identified by \p x
+  */
+  const T& value(stack_type x) const{
+    AP_ERROR_IN_RANGE(x, stack_type(1), psize());
+    return node(x).value;
+  }
+
+  /** Function providing the next element of the node at the given index.
+  * Unlike \p stack_pool<T,N>::next() a copy is returned, since the link is atomic.
+  * Throws if the given index has never been handed out by the pool.
+  * @param x index of a node
+  * @return the next index of the node identified by \p x
+  */
+  stack_type next(stack_type x) const{
+    AP_ERROR_IN_RANGE(x, stack_type(1), psize());
+    return node(x).next.load(std::memory_order_relaxed);
+  }
+
+  /** Function allocating the blocks needed to hold n nodes.
+  * It can be called concurrently with any other operation.
+  * @param n number of required nodes
+  */
+  void reserve(size_type n){
+    for (size_type k=0; k<max_blocks && _block_begin(k)<n; ++k)
+      _block(k);
+  }
+
+  /** Function allowing to assess the current capacity of the pool, i.e. the nodes held by the allocated blocks.
+  * @return the pool capacity
+  */
+  size_type capacity() const noexcept{
+    size_type c=0;
+    for (size_type k=0; k<max_blocks; ++k)
+      if (blocks[k].load(std::memory_order_acquire))
+        c += _block_size(k);
+    return c;
+  }
+
+  /** Function allowing to assess the current size of the pool (nodes in the stacks and in free_nodes).
+  * @return the pool size
+  */
+  size_type psize() const noexcept{
+    return pool_size.load(std::memory_order_acquire);
+  }
+
+
+
+  //___________________FInally_Use_The_Pool_______________________________________//
+
+  /** Function taking l-value references able to add a node to a private stack.
+  * @param val constant reference to the value of the new node
+  * @param head current head of the stack, will be the next of the new node
+  * @return the new head of the stack after adding the new node
+  */
+  stack_type push(const T& val, stack_type head){
+    return _push(val, head);
+  }
+
+  /** Function taking r-value references able to add a node to a private stack.
+  * @param val r-value reference to the value of the new node
+  * @param head current head of the stack, will be the next of the new node
+  * @return the new head of the stack after adding the new node
+  */
+  stack_type push(T&& val, stack_type head){
+    return _push(std::move(val), head);
+  }
+
+  /** Function that deletes the first node of the given private stack, giving it back to free_nodes.
+  * Throws if \p x is \p end() or not a node of the pool.
+  * @param x head of the stack, index of the node to be removed
+  * @return the new head of the stack after removing the first node
+  */
+  stack_type pop(stack_type x){
+    auto n = next(x);
+    _release(x, x);
+    return n;
+  }
+
+  /** Function that deletes an entire private stack, giving all its nodes back to free_nodes.
+  * The stack is walked once to find its last node, then it is linked in front of free_nodes
+  * with a single compare-exchange.
+  * @param x head of the stack
+  * @return the new head of the freed stack, always \p end()
+  */
+  stack_type free_stack(stack_type x){
+    if (empty(x))
+      return end();
+    auto last = x;
+    for (auto n = next(last); !empty(n); n = next(n))
+      last = n;
+    _release(x, last);
+    return end();
+  }
+
+  /** Function pushing a value on a shared stack (Treiber push).
+  * @param s the shared stack
+  * @param val universal reference to the value of the new node
+  */
+  template <typename V>
+  void push(shared_stack& s, V&& val){
+    auto n = _allocate();
+    node(n).value = std::forward<V>(val);
+    auto old = s.top.load(std::memory_order_relaxed);
+    do{
+      node(n).next.store(_index(old), std::memory_order_relaxed);
+    } while (!s.top.compare_exchange_weak(old, _tagged(n, old), std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  /** Function popping a value from a shared stack (Treiber pop).
+  * The popped node is given back to free_nodes.
+  * @param s the shared stack
+  * @param out where the value of the popped node is moved to
+  * @return false if the stack was empty, true otherwise
+  */
+  bool try_pop(shared_stack& s, T& out){
+    auto old = s.top.load(std::memory_order_acquire);
+    while (!empty(_index(old))){
+      auto n = node(_index(old)).next.load(std::memory_order_relaxed);
+      if (s.top.compare_exchange_weak(old, _tagged(n, old), std::memory_order_acquire,
+                                      std::memory_order_acquire)){
+        auto x = _index(old);
+        out = std::move(node(x).value);
+        _release(x, x);
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+ private:
+
+  /**Function providing the index stored in a tagged word. */
+  static stack_type _index(tagged_type t) noexcept{
+    return static_cast<stack_type>(t & 0xffffffffu);
+  }
+
+  /**Function building the tagged word replacing \p old, with index \p x and the tag of \p old bumped by one. */
+  static tagged_type _tagged(stack_type x, tagged_type old) noexcept{
+    return ((old >> 32) + 1) << 32 | static_cast<tagged_type>(x);
+  }
+
+  /**Function providing the number of nodes of block k. */
+  static constexpr size_type _block_size(size_type k) noexcept{
+    return size_type(1) << (k + first_block_bits);
+  }
+
+  /**Function providing the position of the most significant bit of j, which is not 0. */
+  static unsigned _msb(std::uint64_t j) noexcept{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(j);
+#else
+    unsigned r = 0;
+    while (j >>= 1)
+      ++r;
+    return r;
+#endif
+  }
+
+  /**Function providing the position of the first node of block k. */
+  static constexpr size_type _block_begin(size_type k) noexcept{
+    return _block_size(k) - _block_size(0);
+  }
+
+  /**Function providing the block k, allocating it if needed.
+   * Two threads racing on the allocation both build a block, the loser deletes its own.
+   */
+  node_t* _block(size_type k){
+    auto b = blocks[k].load(std::memory_order_acquire);
+    if (b == nullptr){
+      auto nb = new node_t[_block_size(k)];
+      if (blocks[k].compare_exchange_strong(b, nb, std::memory_order_acq_rel))
+        b = nb;
+      else
+        delete[] nb;
+    }
+    return b;
+  }
+
+  /**Function providing the node at a given index: a shift and a mask once the block is known.
+   * @param x "stack index" of a node, which is real index + 1
+   * @return the node at the correct index
+   */
+  node_t& node(stack_type x) noexcept{
+    return const_cast<node_t&>(static_cast<const concurrent_stack_pool&>(*this).node(x));
+  }
+
+  /**Constant function providing the node at a given index, see \p node().
+   * @param x "stack index" of a node, which is real index + 1
+   * @return constant reference to the node at the correct index
+   */
+  const node_t& node(stack_type x) const noexcept{
+    const std::uint64_t j = std::uint64_t(x) - 1 + _block_size(0);
+    const unsigned msb = _msb(j);
+    const auto k = msb - first_block_bits;
+    return blocks[k].load(std::memory_order_acquire)[j & ((std::uint64_t(1) << msb) - 1)];
+  }
+
+  /**Function providing a node to be used: the head of free_nodes if any, a never used node otherwise.
+   * The block of a never used node is allocated before its index is published in \p pool_size, so that
+   * every index below \p psize() has its block, and a failed allocation does not burn the index.
+   * Throws if the pool has already handed out every index representable by N, or if a block cannot be allocated.
+   * @return index of the node
+   */
+  stack_type _allocate(){
+    auto old = free_nodes.load(std::memory_order_acquire);
+    while (!empty(_index(old))){
+      auto n = node(_index(old)).next.load(std::memory_order_relaxed);
+      if (free_nodes.compare_exchange_weak(old, _tagged(n, old), std::memory_order_acquire,
+                                           std::memory_order_acquire))
+        return _index(old);
+    }
+    auto i = pool_size.load(std::memory_order_relaxed);
+    do{
+      AP_ERROR(i < std::numeric_limits<stack_type>::max()) << "The pool is full: no more indexes available in N\n";
+      const std::uint64_t j = i + _block_size(0);
+      _block(_msb(j) - first_block_bits);
+    } while (!pool_size.compare_exchange_weak(i, i+1, std::memory_order_release, std::memory_order_relaxed));
+    return static_cast<stack_type>(i+1);
+  }
+
+  /**Function linking the chain [first, last] in front of free_nodes.
+   * @param first first node of the chain
+   * @param last last node of the chain
+   */
+  void _release(stack_type first, stack_type last) noexcept{
+    auto old = free_nodes.load(std::memory_order_relaxed);
+    do{
+      node(last).next.store(_index(old), std::memory_order_relaxed);
+    } while (!free_nodes.compare_exchange_weak(old, _tagged(first, old), std::memory_order_release,
+                                               std::memory_order_relaxed));
+  }
+
+  /**Templated auxiliary function adding a node in front of a private stack.
+   * @param val universal reference to the value of the new node
+   * @param head current head of the stack, index that will become the next of the new node
+   * @return the new head of the stack hence index of the new node
+   */
+  template <typename V>
+  stack_type _push(V&& val, stack_type head){
+    AP_ERROR_IN_RANGE(head, end(), psize());
+    auto n = _allocate();
+    node(n).value = std::forward<V>(val);
+    node(n).next.store(head, std::memory_order_relaxed);
+    return n;
+  }
+
+};
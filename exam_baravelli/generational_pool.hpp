@@ -0,0 +1,240 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "stack_pool.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file generational_pool.hpp
+*	@brief Header file: implementation of class generational_pool, a stack_pool whose heads detect stale uses in O(1)
+*/
+
+
+/**
+* Class \p generational_pool: a \p stack_pool whose heads carry the generation of their node.
+*
+* A plain head is the position of a node: once the node is popped or freed, and maybe reused by another stack,
+* the old head still looks valid, and passing it to \p pop() or \p free_stack() corrupts the pool. The range
+* check of the checking policies cannot tell. \n
+* Here each node has a generation counter of G bits, bumped every time the node leaves a stack
+* (\p pop(), \p free_stack()). The heads handed out are N values with the position of the node in the low bits
+* and its generation in the G high bits: every function taking a head compares the two generations first,
+* in O(1), and throws on a stale head. The check is always on, whatever the checking policy C of the pool:
+* C only decides the checks of the pool itself, which the generation check makes redundant (hence the default \p unchecked). \n
+* Limits:
+* - the pool can hold at most 2^(bits of N - G) - 1 nodes, \p push() throws beyond that
+* - the generations wrap around: a head is detected as stale unless its node left a stack a multiple of 2^G times since
+* - a head taken below the top of a stack (through \p next()) is valid as long as its node is in a stack: use it to read,
+*   passing it to \p pop() or \p free_stack() is still wrong
+* - \p free_stack() walks the stack to bump the generation of every node, it takes O(n)
+*
+* \p end() is 0, the empty stack, and is always valid.
+* @tparam T type of the values carried by each node
+* @tparam N type of the heads, an unsigned integral type holding both the position and the generation
+* @tparam G number of high bits of N holding the generation
+* @tparam L layout of the nodes in memory, see \p pool_layout.hpp
+* @tparam C checking policy of the indexes inside the pool, see \p pool_checks.hpp
+* @tparam A allocator of the nodes
+* @tparam S statistics policy, see \p pool_stats.hpp
+*/
+template <typename T, typename N = std::size_t, unsigned G = 16, typename L = aos_layout, typename C = unchecked,
+          typename A = std::allocator<T>, typename S = no_stats>
+class generational_pool{
+
+  static_assert(std::is_unsigned<N>::value, "generational_pool needs an unsigned head type");
+  static_assert(G > 0 && G < unsigned(std::numeric_limits<N>::digits),
+                "the generation must leave some bits of N to the position");
+
+ public:
+  using value_type = T; // type of the values
+  using stack_type = N; // type of the heads, position and generation
+  using pool_type = stack_pool<T, N, L, C, A, S>;
+  using size_type = decltype(std::declval<const pool_type&>().psize());
+
+  /** number of low bits of a head holding the position of the node */
+  static constexpr unsigned index_bits = std::numeric_limits<N>::digits - G;
+
+  /** largest position of a node, the pool cannot grow past it */
+  static constexpr N max_index = N(~N(0)) >> G;
+
+ private:
+  /** the pool holding the nodes, it only sees positions */
+  pool_type p;
+
+  /** generation of each node, slot 0 is \p end() */
+  std::vector<N> gens;
+
+ public:
+
+  /** Default constructor, the generations have only the slot of \p end(). */
+  generational_pool() : p{}, gens(1) {}
+
+  /** Custom constructor reserving n nodes.
+  * @param n number of nodes to reserve
+  */
+  explicit generational_pool(size_type n) : generational_pool{} {
+    reserve(n);
+  }
+
+  /** Function providing the pool, read only: it is addressed by the positions, see \p index(). */
+  const pool_type& pool() const noexcept { return p; }
+
+  /** Function extracting the position of the node from a head. */
+  static N index(stack_type h) noexcept { return h & max_index; }
+
+  /** Function extracting the generation from a head. */
+  static N generation(stack_type h) noexcept { return h >> index_bits; }
+
+  /** Functions on the empty stack and the size of the pool, see \p stack_pool. */
+  stack_type end() const noexcept { return stack_type(0); }
+  stack_type new_stack() const noexcept { return end(); }
+  bool empty(stack_type h) const noexcept { return h == end(); }
+  size_type psize() const noexcept { return p.psize(); }
+
+  /** Function reserving n nodes in the pool and their generations. */
+  void reserve(size_type n){
+    p.reserve(n);
+    gens.reserve(n+1);
+  }
+
+  /** Function telling whether a head refers to a node that did not leave its stack since the head was handed out,
+  * in O(1). \p end() is always valid.
+  * @param h head of a stack
+  * @return true if h can be used
+  */
+  bool valid(stack_type h) const noexcept{
+    const auto x = index(h);
+    if (x == 0)
+      return h == end();
+    return x <= psize() && gens[x] == generation(h);
+  }
+
+
+  //___________________Access____________________________________________________//
+
+
+  /** Functions providing the value of a node. Throw if \p h is stale or \p end(). */
+  value_type& value(stack_type h){
+    return p.value(_checked(h));
+  }
+  const value_type& value(stack_type h) const{
+    return p.value(_checked(h));
+  }
+
+  /** Function providing the head of the node below, with its current generation. Throws if \p h is stale or \p end().
+  * The result can be used to read the stack, not to pop from the middle of it.
+  */
+  stack_type next(stack_type h) const{
+    return _head(p.next(_checked(h)));
+  }
+
+  /** Function providing the size of a stack, walking it. Throws if \p h is stale. */
+  size_type ssize(stack_type h) const{
+    return empty(h) ? 0 : p.ssize(_checked(h));
+  }
+
+  /** Functions reaching the value of the \b mth node of a stack, see \p stack_pool::reach(). Throw if \p h is stale. */
+  value_type& reach(stack_type h, N m){
+    return p.reach(_checked(h), m);
+  }
+  const value_type& reach(stack_type h, N m) const{
+    return p.reach(_checked(h), m);
+  }
+
+
+  //___________________Push_and_Pop______________________________________________//
+
+
+  /** Functions adding a node to a stack, see \p stack_pool::push().
+  * Throw if \p head is stale, or if the pool would grow past \p max_index.
+  */
+  stack_type push(const value_type& val, stack_type head){
+    return _pushed(p.push(val, _checked_head(head)));
+  }
+  stack_type push(value_type&& val, stack_type head){
+    return _pushed(p.push(std::move(val), _checked_head(head)));
+  }
+
+  /** Function constructing a node in place on top of a stack, see \p stack_pool::emplace(). */
+  template <typename... Args>
+  stack_type emplace(stack_type head, Args&&... args){
+    return _pushed(p.emplace(_checked_head(head), std::forward<Args>(args)...));
+  }
+
+  /** Function removing the first node of a stack, see \p stack_pool::pop().
+  * The generation of the node is bumped, so \p h is stale after the call.
+  * Throws if \p h is stale or \p end().
+  * @param h head of the stack
+  * @return the new head of the stack
+  */
+  stack_type pop(stack_type h){
+    const auto x = _checked(h);
+    const auto n = p.pop(x);
+    _bump(x);
+    return _head(n);
+  }
+
+  /** Function freeing a whole stack, see \p stack_pool::free_stack().
+  * The generations of all its nodes are bumped, which takes a walk of the stack.
+  * Throws if \p h is stale.
+  * @param h head of the stack
+  * @return \p end()
+  */
+  stack_type free_stack(stack_type h){
+    const auto x = _checked_head(h);
+    for (auto y = x; y != 0; y = p.next(y))
+      _bump(y);
+    p.free_stack(x);
+    return end();
+  }
+
+
+ private:
+
+  /** Auxiliary function providing the position of the node of a valid head, throws otherwise. */
+  N _checked(stack_type h) const{
+    AP_ERROR(valid(h)) << "Stale head: node " << index(h) << " is at generation "
+                       << (index(h) <= psize() ? gens[index(h)] : N(0)) << ", the head has " << generation(h) << "\n";
+    AP_ERROR(!empty(h)) << "The stack is empty\n";
+    return index(h);
+  }
+
+  /** Auxiliary function like \p _checked(), where \p end() is accepted. */
+  N _checked_head(stack_type h) const{
+    return empty(h) ? N(0) : _checked(h);
+  }
+
+  /** Auxiliary function packing the position of a node with its current generation. */
+  stack_type _head(N x) const noexcept{
+    return x == 0 ? end() : stack_type(x | (gens[x] << index_bits));
+  }
+
+  /** Auxiliary function moving a node to its next generation, wrapping around after 2^G. */
+  void _bump(N x) noexcept{
+    gens[x] = (gens[x] + 1) & (N(~N(0)) >> index_bits);
+  }
+
+  /** Auxiliary function handing out the head of a node just pushed; the node is given back
+  * if its position does not fit in the low bits of a head. */
+  stack_type _pushed(N x){
+    if (x > max_index){
+      p.pop(x);
+      AP_ERROR(false) << "generational_pool is full: positions past " << max_index << " do not fit next to " << G << " bits of generation\n";
+    }
+    if (gens.size() <= x)
+      gens.resize(std::size_t(x)+1);
+    return _head(x);
+  }
+};
+
+// definitions of the static members, needed when they are odr-used before C++17
+template <typename T, typename N, unsigned G, typename L, typename C, typename A, typename S>
+constexpr unsigned generational_pool<T, N, G, L, C, A, S>::index_bits;
+
+template <typename T, typename N, unsigned G, typename L, typename C, typename A, typename S>
+constexpr N generational_pool<T, N, G, L, C, A, S>::max_index;
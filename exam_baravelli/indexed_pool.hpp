@@ -0,0 +1,287 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "stack_pool.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file indexed_pool.hpp
+*	@brief Header file: implementation of class indexed_pool, a stack_pool with a jump index for logarithmic random access
+*/
+
+
+/**
+* Class \p indexed_pool: a \p stack_pool whose stacks can be accessed at any depth in logarithmic time.
+*
+* \p stack_pool::reach() walks the stack one node at a time, that is O(m). This wrapper keeps, next to the pool,
+* a parallel array with two entries for each node:
+* - \p depth: the number of nodes from the node to the bottom of its stack, itself included (the length of the stack, for a head)
+* - \p jump: a node further down the same stack
+*
+* The jump pointers are the ones of the skew-binary scheme (E. W. Myers, 1983): when x is pushed on p, if the two jumps
+* below p span the same number of nodes, x jumps over both of them, otherwise x jumps to p. Every jump depends only on the
+* nodes below, hence a push computes the entry of the new node in O(1) and a pop has nothing to update. \n
+* \p advance() follows a jump whenever it does not go past the target, a \p next() otherwise, and takes O(log m) steps. \n
+* Operations changing the nodes below a head (\p splice(), \p compact()) do not fix the index: they start a new
+* epoch, and each stack is indexed again the first time it is used, with a single walk down to the first node
+* still up to date (the bottom, after an epoch change). \n
+* The index costs 2 indexes and a \p std::size_t per node. Only the plain heads are supported, handles know
+* their length already. The pool is reachable read-only through \p pool(): changing it behind the back of the
+* wrapper leaves the index outdated, call \p invalidate() in that case.
+* The template parameters are the ones of the indexed \p stack_pool<T,N,L,C,A,S>.
+* @tparam T type of the values carried by each node
+* @tparam N stack/index type
+* @tparam L layout of the nodes in memory, see \p pool_layout.hpp
+* @tparam C checking policy of the indexes, see \p pool_checks.hpp
+* @tparam A allocator of the nodes
+* @tparam S statistics policy, see \p pool_stats.hpp
+*/
+template <typename T, typename N = std::size_t, typename L = aos_layout, typename C = checked,
+          typename A = std::allocator<T>, typename S = no_stats>
+class indexed_pool{
+
+ public:
+  using value_type = T; // type of the values
+  using stack_type = N; // type of the stacks indexes
+  using pool_type = stack_pool<T, N, L, C, A, S>;
+  using size_type = decltype(std::declval<const pool_type&>().psize());
+
+ private:
+  /** the pool holding the nodes */
+  pool_type p;
+
+  /** number of nodes from each node to the bottom of its stack, slot 0 is \p end() */
+  mutable std::vector<stack_type> depth;
+
+  /** node reached by the jump of each node, slot 0 is \p end() */
+  mutable std::vector<stack_type> jump;
+
+  /** epoch in which the entry of each node was computed, 0 means never */
+  mutable std::vector<size_type> stamp;
+
+  /** current epoch, the entries of the previous ones are outdated */
+  size_type epoch{1};
+
+  /** nodes waiting to be indexed, kept to avoid an allocation for each rebuild */
+  mutable std::vector<stack_type> chain;
+
+ public:
+
+  /** Default constructor, the index has only the slot of \p end(). */
+  indexed_pool() : p{}, depth(1), jump(1), stamp(1) {}
+
+  /** Custom constructor reserving n nodes in the pool and in the index.
+  * @param n number of nodes to reserve
+  */
+  explicit indexed_pool(size_type n) : indexed_pool{} {
+    reserve(n);
+  }
+
+  /** Function providing the indexed pool, read only. */
+  const pool_type& pool() const noexcept { return p; }
+
+  /** Functions forwarded to the pool, see \p stack_pool. */
+  stack_type end() const noexcept { return p.end(); }
+  stack_type new_stack() noexcept { return p.new_stack(); }
+  bool empty(stack_type x) const noexcept { return p.empty(x); }
+  size_type psize() const noexcept { return p.psize(); }
+  value_type& value(stack_type x) { return p.value(x); }
+  const value_type& value(stack_type x) const { return p.value(x); }
+  const stack_type& next(stack_type x) const { return p.next(x); }
+
+  /** Function reserving n nodes in the pool and their entries in the index. */
+  void reserve(size_type n){
+    p.reserve(n);
+    depth.reserve(n+1);
+    jump.reserve(n+1);
+    stamp.reserve(n+1);
+  }
+
+
+  //___________________Push_and_Pop______________________________________________//
+
+
+  /** Functions adding a node to a stack and indexing it in O(1), see \p stack_pool::push(). */
+  stack_type push(const value_type& val, stack_type head){
+    return _indexed(p.push(val, head), head);
+  }
+  stack_type push(value_type&& val, stack_type head){
+    return _indexed(p.push(std::move(val), head), head);
+  }
+
+  /** Function constructing a node in place on top of a stack and indexing it in O(1), see \p stack_pool::emplace(). */
+  template <typename... Args>
+  stack_type emplace(stack_type head, Args&&... args){
+    return _indexed(p.emplace(head, std::forward<Args>(args)...), head);
+  }
+
+  /** Functions removing nodes, the index of the nodes left is unchanged. */
+  stack_type pop(stack_type x){ return p.pop(x); }
+  stack_type free_stack(stack_type x){ return p.free_stack(x); }
+  template <typename O>
+  stack_type pop_n(stack_type x, size_type k, O out){ return p.pop_n(x, k, out); }
+
+
+  //___________________Bulk_Operations___________________________________________//
+
+
+  /** Function adding the values in [first, last) to a stack, see \p stack_pool::push_range().
+  * The new nodes are marked as outdated, they are indexed the first time the stack is used.
+  * @param first beginning of the range
+  * @param last end of the range
+  * @param head current head of the stack
+  * @return the new head of the stack
+  */
+  template <typename It>
+  stack_type push_range(It first, It last, stack_type head){
+    const auto x = p.push_range(first, last, head);
+    _fit();
+    // reused free nodes may carry an entry of the current epoch
+    for (auto y = x; y != head; y = p.next(y))
+      stamp[y] = 0;
+    return x;
+  }
+
+  /** Function moving a whole stack on top of another one, see \p stack_pool::splice().
+  * The last node of \p from is found through the index, in O(log n); the index of every stack is then
+  * outdated, since the depths of the nodes of \p from changed. Throws if a head is larger than \p psize().
+  * @param from head of the stack to move
+  * @param onto head of the stack receiving it, must be a different stack
+  * @return the head of the joined stack
+  */
+  stack_type splice(stack_type from, stack_type onto){
+    AP_ERROR_IN_RANGE(onto, end(), psize());
+    if (empty(from))
+      return onto;
+    const auto tail = advance(from, ssize(from)-1);
+    p.next(tail) = onto;
+    invalidate();
+    return from;
+  }
+
+  /** Function compacting the pool, see \p stack_pool::compact(). The index is rebuilt lazily.
+  * @param heads heads of all the live stacks
+  * @param release if true, the memory left unused is given back to the system
+  * @return the new heads, in the same order
+  */
+  std::vector<stack_type> compact(std::vector<stack_type> heads, bool release=false){
+    heads = p.compact(std::move(heads), release);
+    depth.resize(psize()+1);
+    jump.resize(psize()+1);
+    stamp.resize(psize()+1);
+    if (release){
+      depth.shrink_to_fit();
+      jump.shrink_to_fit();
+      stamp.shrink_to_fit();
+    }
+    invalidate();
+    return heads;
+  }
+
+  /** Function marking the whole index as outdated, in O(1): each stack is indexed again when used. */
+  void invalidate() noexcept { ++epoch; }
+
+
+  //___________________Random_Access_____________________________________________//
+
+
+  /** Function providing the size of a stack, O(1) once the stack is indexed.
+  * Throws if \p x is larger than \p psize().
+  * @param x head of the stack
+  * @return number of nodes of the stack
+  */
+  size_type ssize(stack_type x) const{
+    _ensure(x);
+    return depth[x];
+  }
+
+  /** Function providing the node m positions below x, in O(log m) once the stack is indexed.
+  * \p advance(x, 0) is x, \p advance(x, ssize(x)) is \p end(). \n
+  * Throws if \p x is larger than \p psize() or if m is larger than \p ssize(x).
+  * @param x stack index
+  * @param m number of nodes to skip
+  * @return index of the reached node
+  */
+  stack_type advance(stack_type x, size_type m) const{
+    _ensure(x);
+    AP_ERROR_IN_RANGE(m, size_type(0), size_type(depth[x]));
+    const auto d = depth[x] - m;
+    while (depth[x] > d){
+      const auto j = jump[x];
+      x = depth[j] >= d ? j : p.next(x);
+    }
+    return x;
+  }
+
+  /** Function reaching the value of the \b mth node of a stack, with the convention of \p stack_pool::reach():
+  * the first node is m=1 (as m=0), the last m=ssize(x). O(log m) once the stack is indexed. \n
+  * Throws if the stack is empty or if m is larger than \p ssize(x).
+  * @param x stack index
+  * @param m the hierarchical number of a node, going from the first (1) to the last ( \p ssize(x) )
+  * @return reference to the value of the reached node
+  */
+  value_type& reach(stack_type x, stack_type m){
+    return p.value(_reach(x, m));
+  }
+  const value_type& reach(stack_type x, stack_type m) const{
+    return p.value(_reach(x, m));
+  }
+
+
+ private:
+
+  /** Auxiliary function providing the index of the \b mth node of a stack, see \p reach(). */
+  stack_type _reach(stack_type x, stack_type m) const{
+    AP_ERROR(!empty(x)) << "Cannot reach a node of an empty stack\n";
+    return advance(x, m==0 ? 0 : size_type(m)-1);
+  }
+
+  /** Auxiliary function growing the index along with the pool, new slots are outdated. */
+  void _fit() const{
+    if (depth.size() <= psize()){
+      depth.resize(psize()+1);
+      jump.resize(psize()+1);
+      stamp.resize(psize()+1);
+    }
+  }
+
+  /** Auxiliary function telling whether the entry of a node is up to date, \p end() always is. */
+  bool _current(stack_type x) const noexcept{
+    return empty(x) || stamp[x] == epoch;
+  }
+
+  /** Auxiliary function computing the entry of x, pushed on n, whose entry must be up to date. */
+  void _set(stack_type x, stack_type n) const noexcept{
+    const auto j = jump[n];
+    depth[x] = depth[n] + 1;
+    jump[x] = depth[n] - depth[j] == depth[j] - depth[jump[j]] ? jump[j] : n;
+    stamp[x] = epoch;
+  }
+
+  /** Auxiliary function indexing a node just pushed on head. */
+  stack_type _indexed(stack_type x, stack_type head){
+    _fit();
+    _ensure(head);
+    _set(x, head);
+    return x;
+  }
+
+  /** Auxiliary function bringing the index of a stack up to date: the stack is walked down to the first
+  * node whose entry is current, then the entries are computed from there up to x.
+  * Throws if \p x is larger than \p psize().
+  */
+  void _ensure(stack_type x) const{
+    AP_ERROR_IN_RANGE(x, end(), stack_type(psize()));
+    _fit();
+    if (_current(x))
+      return;
+    chain.clear();
+    for (; !_current(x); x = p.next(x))
+      chain.push_back(x);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+      _set(*it, p.next(*it));
+  }
+};
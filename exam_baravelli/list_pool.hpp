@@ -0,0 +1,386 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "stack_pool.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file list_pool.hpp
+*	@brief Header file: implementation of class list_pool, a pool of doubly linked lists, and of its iterator
+*/
+
+
+/**
+* Class \p _list_iterator: bidirectional iterator walking a list of a list_pool.
+*
+* Going forward follows the next index of the nodes, going backward the prev one. The iterator past the last node
+* has the index \p end(), so it keeps the tail of the list to step back from there: an iterator equal to \p end()
+* of a list can be decremented until the back of the list changes.
+*
+* @tparam T type of the values carried by each node, const for a const iterator
+* @tparam N stack/index type
+* @tparam L_P list_pool type, const for a const iterator
+*/
+template <typename T, typename N, typename L_P>
+class _list_iterator {
+
+  using pool_type = L_P;
+  using stack_type = N;
+
+  /** Pointer to the list_pool.*/
+  pool_type* pool_ptr;
+  /** Index of the current node, \p end() past the last one.*/
+  stack_type index;
+  /** Index of the last node of the list, reached when decrementing from \p end().*/
+  stack_type tail;
+
+
+ public:
+  using value_type = typename std::remove_const<T>::type;
+  using reference = T&;
+  using pointer = T*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+
+  /** Custom constructor: initializes the iterator at node \p x of the list whose last node is \p last.
+  * @param x index of the node
+  * @param last index of the last node of the list
+  * @param my_pool pointer to the list_pool
+  */
+  _list_iterator(stack_type x, stack_type last, pool_type* const my_pool) :
+    pool_ptr{my_pool},
+    index{x},
+    tail{last}{}
+
+
+  /** Dereference operator, throws through \p list_pool::value() if the iterator is past the last node. */
+  reference operator*() const {
+    return pool_ptr -> value(index);
+  }
+
+  pointer operator ->() const {
+    return &**this;
+  }
+
+  /** PreIncrement, throws through \p list_pool::next() if the iterator is past the last node. */
+  _list_iterator& operator++() {
+    index = pool_ptr -> next(index);
+    return *this;
+  }
+
+  _list_iterator operator++(int) {
+    auto tmp = *this;
+    ++(*this);
+    return tmp;
+  }
+
+  /** PreDecrement: from \p end() it goes to the last node of the list. */
+  _list_iterator& operator--() {
+    index = index == pool_ptr -> end() ? tail : pool_ptr -> prev(index);
+    return *this;
+  }
+
+  _list_iterator operator--(int) {
+    auto tmp = *this;
+    --(*this);
+    return tmp;
+  }
+
+  /** Function providing the index of the current node, to be passed to the functions of the pool. */
+  stack_type node() const noexcept { return index; }
+
+  friend bool operator==(const _list_iterator& x, const _list_iterator& y) {
+    return x.index == y.index;
+  }
+
+  friend bool operator!=(const _list_iterator& x, const _list_iterator& y) {
+    return !(x == y);
+  }
+};
+
+
+
+
+/**
+* Class \p list_pool: pool of doubly linked lists, each node knowing both its next and its previous node.
+*
+* The values and the next indexes live in a \p stack_pool, with the same layouts, the same 1-based indexes
+* with 0 as \p end() and the same recycling of the removed nodes through free_nodes; the previous indexes are
+* an array parallel to it, slot 0 being \p end(). The nodes of all the lists share the storage, so a list costs
+* no allocation of its own and a node costs none once the pool has grown. \n
+* A list is identified by a \p list, the \p handle of \p stack_pool: first node, last node and length. Knowing the
+* neighbours of every node, all these take O(1):
+* - \p insert_before() a node, \p push_front(), \p push_back()
+* - \p erase() a node, \p pop_front(), \p pop_back()
+* - \p splice() of a node or of a whole list into another list
+* - \p free_list(), which gives the whole list to free_nodes
+*
+* Each of them changes both the nodes and the ends of the list, so, unlike \p stack_pool, they take the \p list
+* by reference and update it in place; the returned value is a node, as for the iterators of \p std::list.
+* The indexes of the nodes are stable: a node keeps its index until it is erased, whatever happens to the others.
+* Passing a node that is not in the given list corrupts both lists.
+* @tparam T type of the values carried by each node
+* @tparam N stack/index type
+* @tparam L layout of the nodes in memory, see \p pool_layout.hpp
+* @tparam C checking policy of the indexes, see \p pool_checks.hpp
+* @tparam A allocator of the nodes
+* @tparam S statistics policy, see \p pool_stats.hpp
+*/
+template <typename T, typename N = std::size_t, typename L = aos_layout, typename C = checked,
+          typename A = std::allocator<T>, typename S = no_stats>
+class list_pool{
+
+ public:
+  using value_type = T; // type of the values
+  using stack_type = N; // type of the indexes
+  using pool_type = stack_pool<T, N, L, C, A, S>;
+  using size_type = decltype(std::declval<const pool_type&>().psize());
+
+  /** A list: \p head is its first node, \p tail its last one and \p length the number of nodes. */
+  using list = typename pool_type::handle;
+
+  using iterator = _list_iterator<T, N, list_pool>;
+  using const_iterator = _list_iterator<const T, N, const list_pool>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+ private:
+  /** the pool holding the values and the next indexes */
+  pool_type p;
+
+  /** index of the previous node of each node, slot 0 is \p end(); meaningless for free nodes */
+  std::vector<N> prevs;
+
+ public:
+
+  /** Default constructor, the pool is empty. */
+  list_pool() : p{}, prevs(1) {}
+
+  /** Custom constructor reserving n nodes.
+  * @param n number of nodes to reserve
+  */
+  explicit list_pool(size_type n) : list_pool{} {
+    reserve(n);
+  }
+
+  /** Function providing the underlying pool, read only. */
+  const pool_type& pool() const noexcept { return p; }
+
+  /** Function providing an empty list. */
+  list new_list() const noexcept { return list{end(), 0, end()}; }
+
+  stack_type end() const noexcept { return p.end(); }
+  bool empty(const list& l) const noexcept { return p.empty(l.head); }
+  size_type size(const list& l) const noexcept { return l.length; }
+
+  /** Functions forwarded to the pool, see \p stack_pool. */
+  size_type capacity() const noexcept { return p.capacity(); }
+  size_type psize() const noexcept { return p.psize(); }
+
+  /** Function reserving n nodes in the pool and their previous indexes. */
+  void reserve(size_type n){
+    p.reserve(n);
+    prevs.reserve(n+1);
+  }
+
+
+  //____________Iterators_Domain___________________________________________//
+
+
+  /** Functions providing the iterators walking a list from the first node to the last one, and back. */
+  iterator begin(const list& l){ return iterator{l.head, l.tail, this}; }
+  iterator end(const list& l){ return iterator{end(), l.tail, this}; }
+  const_iterator begin(const list& l) const{ return cbegin(l); }
+  const_iterator end(const list& l) const{ return cend(l); }
+  const_iterator cbegin(const list& l) const{ return const_iterator{l.head, l.tail, this}; }
+  const_iterator cend(const list& l) const{ return const_iterator{end(), l.tail, this}; }
+
+  reverse_iterator rbegin(const list& l){ return reverse_iterator{end(l)}; }
+  reverse_iterator rend(const list& l){ return reverse_iterator{begin(l)}; }
+  const_reverse_iterator crbegin(const list& l) const{ return const_reverse_iterator{cend(l)}; }
+  const_reverse_iterator crend(const list& l) const{ return const_reverse_iterator{cbegin(l)}; }
+
+
+  //___________________Access____________________________________________________//
+
+
+  /** Functions providing the value of a node. Throw if \p x is \p end() or larger than \p psize(). */
+  T& value(stack_type x){ return p.value(x); }
+  const T& value(stack_type x) const{ return p.value(x); }
+
+  /** Function providing the node after \p x, \p end() for the last node. Throws if \p x is \p end() or larger than \p psize(). */
+  stack_type next(stack_type x) const{ return p.next(x); }
+
+  /** Function providing the node before \p x, \p end() for the first node. Throws if \p x is \p end() or larger than \p psize(). */
+  stack_type prev(stack_type x) const{
+    C::in_range(x, stack_type(1), psize());
+    return prevs[x];
+  }
+
+  /** Functions providing the first and the last value of a list. Throw if the list is empty. */
+  T& front(const list& l){ return p.value(_not_empty(l).head); }
+  const T& front(const list& l) const{ return p.value(_not_empty(l).head); }
+  T& back(const list& l){ return p.value(_not_empty(l).tail); }
+  const T& back(const list& l) const{ return p.value(_not_empty(l).tail); }
+
+
+  //___________________Insert_and_Erase__________________________________________//
+
+
+  /** Functions adding a value to a list before the node \p pos, in O(1); \p pos equal to \p end() adds it at the back.
+  * The node is taken from free_nodes if possible, as in \p stack_pool::push(). Throws if \p pos is larger than \p psize()
+  * or through the copy of the value; the list is unchanged in that case.
+  * @param l the list, updated
+  * @param pos node of the list, or \p end()
+  * @param val value of the new node
+  * @return the new node
+  */
+  stack_type insert_before(list& l, stack_type pos, const T& val){
+    return emplace_before(l, pos, val);
+  }
+  stack_type insert_before(list& l, stack_type pos, T&& val){
+    return emplace_before(l, pos, std::move(val));
+  }
+
+  /** Function adding a value constructed in place from \p args to a list before the node \p pos, see \p insert_before(). */
+  template <typename... Args>
+  stack_type emplace_before(list& l, stack_type pos, Args&&... args){
+    const auto before = _before(l, pos);
+    if (prevs.size() < std::size_t(psize())+2)
+      prevs.resize(std::size_t(psize())+2);
+    const auto x = p.emplace(pos, std::forward<Args>(args)...);
+    _link(l, before, x, pos);
+    ++l.length;
+    return x;
+  }
+
+  /** Functions adding a value at the front or at the back of a list, see \p insert_before(). */
+  stack_type push_front(list& l, const T& val){ return emplace_before(l, l.head, val); }
+  stack_type push_front(list& l, T&& val){ return emplace_before(l, l.head, std::move(val)); }
+  stack_type push_back(list& l, const T& val){ return emplace_before(l, end(), val); }
+  stack_type push_back(list& l, T&& val){ return emplace_before(l, end(), std::move(val)); }
+
+  template <typename... Args>
+  stack_type emplace_back(list& l, Args&&... args){
+    return emplace_before(l, end(), std::forward<Args>(args)...);
+  }
+
+  /** Function removing a node from a list, in O(1): its value is destroyed and the node goes to free_nodes.
+  * Throws if \p x is \p end() or larger than \p psize().
+  * @param l the list, updated
+  * @param x node of the list
+  * @return the node that followed \p x
+  */
+  stack_type erase(list& l, stack_type x){
+    const auto after = _unlink(l, x);
+    p.pop(x);
+    return after;
+  }
+
+  /** Functions removing the first or the last node of a list. Throw if the list is empty. */
+  void pop_front(list& l){ erase(l, _not_empty(l).head); }
+  void pop_back(list& l){ erase(l, _not_empty(l).tail); }
+
+  /** Function removing all the nodes of a list, the whole chain goes to free_nodes in O(1)
+  * (plus the destruction of the values if T is not trivially destructible).
+  * @param l the list, empty after the call
+  */
+  void free_list(list& l){
+    l = p.free_stack(l);
+  }
+
+
+  //___________________Splice____________________________________________________//
+
+
+  /** Function moving all the nodes of \p other before the node \p pos of \p l, in O(1).
+  * No node is copied or moved in memory, and their indexes do not change. The two lists must be different.
+  * Throws if \p pos is larger than \p psize().
+  * @param l the list receiving the nodes, updated
+  * @param pos node of \p l, or \p end() to append
+  * @param other the list giving the nodes, empty after the call
+  */
+  void splice(list& l, stack_type pos, list& other){
+    const auto before = _before(l, pos);
+    if (empty(other))
+      return;
+    prevs[other.head] = before;
+    _link_after(l, before, other.head);
+    p.next(other.tail) = pos;
+    _link_before(l, other.tail, pos);
+    l.length += other.length;
+    other = new_list();
+  }
+
+  /** Function moving the node \p x of \p other before the node \p pos of \p l, in O(1). \p l and \p other can be
+  * the same list, then \p x is moved inside it; \p pos equal to \p x leaves the list unchanged. \n
+  * Throws if \p x is \p end() or if one of the nodes is larger than \p psize().
+  * @param l the list receiving the node, updated
+  * @param pos node of \p l, or \p end() to append
+  * @param other the list holding \p x, updated
+  * @param x node to move
+  */
+  void splice(list& l, stack_type pos, list& other, stack_type x){
+    _before(l, pos);
+    if (pos == x)
+      return;
+    _unlink(other, x);
+    _link(l, _before(l, pos), x, pos);
+    ++l.length;
+  }
+
+
+ private:
+
+  /** Auxiliary function checking that a list is not empty. */
+  const list& _not_empty(const list& l) const{
+    AP_ERROR(!empty(l)) << "The list is empty\n";
+    return l;
+  }
+
+  /** Auxiliary function providing the node that precedes \p pos in \p l, its tail if \p pos is \p end(). */
+  stack_type _before(const list& l, stack_type pos) const{
+    return p.empty(pos) ? l.tail : prev(pos);
+  }
+
+  /** Auxiliary function making \p x the node after \p before, or the head if \p before is \p end(). */
+  void _link_after(list& l, stack_type before, stack_type x){
+    if (p.empty(before))
+      l.head = x;
+    else
+      p.next(before) = x;
+  }
+
+  /** Auxiliary function making \p x the node before \p after, or the tail if \p after is \p end(). */
+  void _link_before(list& l, stack_type x, stack_type after){
+    if (p.empty(after))
+      l.tail = x;
+    else
+      prevs[after] = x;
+  }
+
+  /** Auxiliary function linking the node \p x between \p before and \p after. */
+  void _link(list& l, stack_type before, stack_type x, stack_type after){
+    prevs[x] = before;
+    p.next(x) = after;
+    _link_after(l, before, x);
+    _link_before(l, x, after);
+  }
+
+  /** Auxiliary function taking the node \p x out of \p l, its neighbours are linked together. */
+  stack_type _unlink(list& l, stack_type x){
+    AP_ERROR(!p.empty(x)) << "Cannot erase end()\n";
+    const auto before = prev(x);
+    const auto after = p.next(x);
+    _link_after(l, before, after);
+    _link_before(l, before, after);
+    --l.length;
+    return after;
+  }
+};
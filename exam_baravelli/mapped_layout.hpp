@@ -0,0 +1,297 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ap_error.hpp"
+
+
+/**
+*	@file mapped_layout.hpp
+*	@brief Header file: persistent layout for stack_pool, living in a memory-mapped file (POSIX only)
+*/
+
+
+/**
+* Layout \p mapped_layout: the nodes of the pool live in a memory-mapped file.
+*
+* The file starts with a small header (format version, \p sizeof(T), \p sizeof(N), number of nodes,
+* capacity, head of free_nodes and one user root), followed by the array of nodes laid out as in \p aos_layout.
+* Opening an existing file only maps it: the pool is available in O(1) and its pages are read lazily
+* by the kernel on first access, instead of replaying millions of pushes. \n
+* The file grows in extents of E bytes (rounded to whole nodes): the file is extended (sparse on most file systems)
+* and mapped again, hence, like for \p std::vector, references to values are invalidated when the pool grows. \n
+* Durability: \p stack_pool<T,N,L>::sync() writes the free list to the header and flushes the mapping to disk.
+* The destructor of the pool writes the header too, but does not wait for the disk. After a crash the file
+* is consistent only if nothing changed since the last \p sync(). \n
+* Only trivially copyable values can be stored, since they are written to the file as they are in memory.
+* The file is used by a single pool at a time, nothing prevents two processes from opening it: don't.
+* @tparam E size in bytes of the extents by which the file grows
+*/
+template <std::size_t E = (std::size_t(64) << 20)>
+struct mapped_layout{
+
+  /**
+  * @tparam T type of the values carried by each node, must be trivially copyable
+  * @tparam N stack/index type
+  * @tparam A allocator, unused: the nodes live in the mapping of the file
+  */
+  template <typename T, typename N, typename A = std::allocator<T>>
+  class storage{
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "mapped_layout can only store trivially copyable values");
+
+    /** Class \p node_t, implementing the concept of node of a stack*/
+    struct node_t{
+      /** value of type T carried by the node */
+      T value;
+
+      /** index to the next node, type N */
+      N next;
+    };
+
+    /** Header of the file, its fields are updated in place. */
+    struct header_t{
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t value_size;
+      std::uint32_t index_size;
+      std::uint32_t node_size;
+      std::uint64_t size;
+      std::uint64_t capacity;
+      N free_nodes;
+      N root;
+    };
+
+   public:
+    using size_type = std::size_t;
+
+   private:
+    static constexpr std::uint32_t version = 1;
+
+    /** bytes reserved to the header, the nodes start right after */
+    static constexpr size_type header_bytes = 64;
+    static_assert(sizeof(header_t) <= header_bytes && header_bytes % alignof(node_t) == 0,
+                  "the header must fit in its slot and keep the nodes aligned");
+
+    /** number of nodes in an extent */
+    static constexpr size_type extent = E / sizeof(node_t) > 0 ? E / sizeof(node_t) : 1;
+
+    int fd{-1};
+    void* base{nullptr};
+    size_type mapped_bytes{0};
+
+    header_t& header() noexcept { return *static_cast<header_t*>(base); }
+    const header_t& header() const noexcept { return *static_cast<const header_t*>(base); }
+
+    node_t* nodes() noexcept {
+      return reinterpret_cast<node_t*>(static_cast<char*>(base) + header_bytes);
+    }
+    const node_t* nodes() const noexcept {
+      return reinterpret_cast<const node_t*>(static_cast<const char*>(base) + header_bytes);
+    }
+
+    /** Function mapping the first \p bytes bytes of the file, replacing the current mapping.
+    * The old mapping is released only once the new one succeeded: if \p mmap fails, it is left intact. */
+    void map(size_type bytes){
+      auto p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      AP_ERROR(p != MAP_FAILED) << "mmap failed: " << std::strerror(errno) << "\n";
+      if (base)
+        ::munmap(base, mapped_bytes);
+      base = p;
+      mapped_bytes = bytes;
+    }
+
+    /** Function resizing the file and the mapping to hold at least n nodes, in whole extents.
+    * The file is extended before being mapped and shrunk after, so that the mapping never goes past its end;
+    * if extending or mapping throws, the pool keeps its current mapping and capacity (the file may be left larger). */
+    void resize_file(size_type n){
+      const auto cap = (n + extent - 1) / extent * extent;
+      const auto bytes = header_bytes + cap * sizeof(node_t);
+      const auto grow = bytes > mapped_bytes;
+      if (grow)
+        AP_ERROR(::ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+            << "cannot extend the pool file: " << std::strerror(errno) << "\n";
+      map(bytes);
+      header().capacity = cap;
+      if (!grow)
+        AP_ERROR(::ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+            << "cannot shrink the pool file: " << std::strerror(errno) << "\n";
+    }
+
+    /** Function releasing the mapping and the file descriptor. */
+    void close() noexcept{
+      if (base)
+        ::munmap(base, mapped_bytes);
+      if (fd >= 0)
+        ::close(fd);
+      base = nullptr;
+      fd = -1;
+    }
+
+   public:
+    /** Custom constructor opening the pool stored in \p path, or creating it if the file does not exist or is empty.
+    * Throws if the file cannot be opened or mapped, or if it was written with a different format,
+    * value size or index size.
+    * @param path the file backing the pool
+    */
+    explicit storage(const std::string& path){
+      fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      AP_ERROR(fd >= 0) << "cannot open " << path << ": " << std::strerror(errno) << "\n";
+      try{
+        struct stat st;
+        AP_ERROR(::fstat(fd, &st) == 0) << "cannot stat " << path << "\n";
+        if (st.st_size == 0){
+          resize_file(extent);
+          auto& h = header();
+          std::memcpy(h.magic, "STKPOOL", 8);
+          h.version = version;
+          h.value_size = sizeof(T);
+          h.index_size = sizeof(N);
+          h.node_size = sizeof(node_t);
+          h.size = 0;
+          h.free_nodes = 0;
+          h.root = 0;
+          return;
+        }
+        AP_ERROR(size_type(st.st_size) >= header_bytes) << path << " is not a stack_pool file\n";
+        map(header_bytes);
+        const auto& h = header();
+        AP_ERROR(std::memcmp(h.magic, "STKPOOL", 8) == 0) << path << " is not a stack_pool file\n";
+        AP_ERROR_EQ(h.version, version);
+        AP_ERROR_EQ(h.value_size, sizeof(T));
+        AP_ERROR_EQ(h.index_size, sizeof(N));
+        AP_ERROR_EQ(h.node_size, sizeof(node_t));
+        const auto bytes = header_bytes + h.capacity * sizeof(node_t);
+        AP_ERROR(size_type(st.st_size) >= bytes) << path << " is truncated\n";
+        map(bytes);
+      }catch(...){
+        close();
+        throw;
+      }
+    }
+
+    storage(const storage&) = delete;
+    storage& operator=(const storage&) = delete;
+
+    /** Move constructor, the moved-from storage is closed. */
+    storage(storage&& other) noexcept
+      : fd{other.fd},
+        base{other.base},
+        mapped_bytes{other.mapped_bytes} {
+      other.fd = -1;
+      other.base = nullptr;
+    }
+
+    /** Move assignment, closes the current file first. */
+    storage& operator=(storage&& other) noexcept{
+      if (this != &other){
+        close();
+        std::swap(fd, other.fd);
+        std::swap(base, other.base);
+        std::swap(mapped_bytes, other.mapped_bytes);
+      }
+      return *this;
+    }
+
+    ~storage() noexcept { close(); }
+
+    T& value(size_type i) noexcept { return nodes()[i].value; }
+    const T& value(size_type i) const noexcept { return nodes()[i].value; }
+
+    N& next(size_type i) noexcept { return nodes()[i].next; }
+    const N& next(size_type i) const noexcept { return nodes()[i].next; }
+
+    /** Function adding a node at the end, extending the file by one extent if it is full.
+    * The value is built before the file is mapped again, since the arguments may refer to values of the pool.
+    * @param n index of the next node
+    * @param args arguments forwarded to the constructor of T
+    */
+    template <typename... Args>
+    void emplace_back(N n, Args&&... args){
+      T tmp(std::forward<Args>(args)...);
+      reserve(size() + 1);
+      auto p = nodes() + size();
+      ::new (static_cast<void*>(std::addressof(p->value))) T(std::move(tmp));
+      p->next = n;
+      ++header().size;
+    }
+
+    /** Functions constructing and destroying the value of a node, the latter is a no-op
+    * since the values are trivially copyable, hence the liveness is not tracked. */
+    template <typename... Args>
+    void construct(size_type i, Args&&... args){
+      ::new (static_cast<void*>(std::addressof(nodes()[i].value))) T(std::forward<Args>(args)...);
+    }
+    void destroy(size_type) noexcept {}
+    bool alive(size_type) const noexcept { return true; }
+
+    size_type size() const noexcept { return header().size; }
+    size_type capacity() const noexcept { return header().capacity; }
+
+    /** Function extending the file to hold at least n nodes, in whole extents. */
+    void reserve(size_type n){
+      if (n > capacity())
+        resize_file(n);
+    }
+
+    /** Function forgetting the nodes from position n on (values are trivially destructible). */
+    void truncate(size_type n) noexcept { header().size = n; }
+
+    /** Function shrinking the file to the extents needed by the current nodes (at least one). */
+    void shrink_to_fit(){
+      const auto n = size() > 0 ? size() : 1;
+      if ((n + extent - 1) / extent * extent < capacity())
+        resize_file(n);
+    }
+
+    /** Function providing the size of the mapping, header included. */
+    size_type allocated_bytes() const noexcept { return mapped_bytes; }
+
+    //____________Persistence__________________________________________________//
+
+    /** Function providing the head of free_nodes saved in the header. */
+    N saved_free_nodes() const noexcept { return header().free_nodes; }
+
+    /** Function providing the user root saved in the header, a stack head that survives reopening. */
+    N& root() noexcept { return header().root; }
+    const N& root() const noexcept { return header().root; }
+
+    /** Function writing the head of free_nodes to the header. */
+    void store(N free_nodes) noexcept {
+      if (base)
+        header().free_nodes = free_nodes;
+    }
+
+    /** Function writing the head of free_nodes to the header and flushing the whole mapping to disk.
+    * Throws if \p msync fails.
+    */
+    void sync(N free_nodes){
+      store(free_nodes);
+      AP_ERROR(::msync(base, mapped_bytes, MS_SYNC) == 0) << "msync failed: " << std::strerror(errno) << "\n";
+    }
+  };
+};
+
+// definitions of the static members, needed when they are odr-used before C++17
+template <std::size_t E>
+template <typename T, typename N, typename A>
+constexpr std::uint32_t mapped_layout<E>::storage<T, N, A>::version;
+
+template <std::size_t E>
+template <typename T, typename N, typename A>
+constexpr typename mapped_layout<E>::template storage<T, N, A>::size_type mapped_layout<E>::storage<T, N, A>::header_bytes;
+
+template <std::size_t E>
+template <typename T, typename N, typename A>
+constexpr typename mapped_layout<E>::template storage<T, N, A>::size_type mapped_layout<E>::storage<T, N, A>::extent;
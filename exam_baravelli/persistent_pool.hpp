@@ -0,0 +1,198 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "stack_pool.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file persistent_pool.hpp
+*	@brief Header file: implementation of class persistent_pool, a stack_pool whose stacks share their tails
+*/
+
+
+/**
+* Class \p persistent_pool: a \p stack_pool of persistent stacks, where versions share their common nodes.
+*
+* In a \p stack_pool a node belongs to a single stack, so forking a stack means copying it. Here a head is
+* a version of a stack, and any number of versions can be pushed on top of the same node: they share it, and all the nodes below. \n
+* Each node has a reference count, kept in an array parallel to the pool, counting the heads held by the user
+* and the nodes pushed on top of it. The heads follow the rules of a \p std::unique_ptr, with explicit copies:
+* - \p push() and \p pop() take over the head they are given and return a new one, as in \p stack_pool:
+*   \p l = pool.push(v, l) costs no reference count more than in \p stack_pool
+* - \p share() copies a head, in O(1): the copy and the original are two versions to be released independently
+* - \p pop() and \p free_stack() release the nodes whose last reference drops, and give them to free_nodes;
+*   \p free_stack() stops at the first node still referenced, so it takes O(number of released nodes)
+*
+* Hence the memory of many versions grows with the number of distinct nodes, not with the sum of their lengths. \n
+* The values of the nodes are read only, since a node can be in many versions. A head must not be used
+* after it is passed to \p push(), \p pop() or \p free_stack(); heads taken from \p next() are not references,
+* \p share() them to keep them.
+* @tparam T type of the values carried by each node
+* @tparam N stack/index type
+* @tparam L layout of the nodes in memory, see \p pool_layout.hpp
+* @tparam C checking policy of the indexes, see \p pool_checks.hpp
+* @tparam A allocator of the nodes
+* @tparam S statistics policy, see \p pool_stats.hpp
+*/
+template <typename T, typename N = std::size_t, typename L = aos_layout, typename C = checked,
+          typename A = std::allocator<T>, typename S = no_stats>
+class persistent_pool{
+
+ public:
+  using value_type = T; // type of the values
+  using stack_type = N; // type of the stacks indexes
+  using pool_type = stack_pool<T, N, L, C, A, S>;
+  using size_type = decltype(std::declval<const pool_type&>().psize());
+
+ private:
+  /** the pool holding the nodes */
+  pool_type p;
+
+  /** number of references to each node, 0 for free nodes; slot 0 is \p end() and is not counted */
+  std::vector<size_type> refs;
+
+  /** number of nodes with at least a reference */
+  size_type live{0};
+
+ public:
+
+  /** Default constructor, no node is referenced. */
+  persistent_pool() : p{}, refs(1) {}
+
+  /** Custom constructor reserving n nodes.
+  * @param n number of nodes to reserve
+  */
+  explicit persistent_pool(size_type n) : persistent_pool{} {
+    reserve(n);
+  }
+
+  /** Function providing the pool, read only, e.g. to iterate on a version with \p cbegin() and \p cend(). */
+  const pool_type& pool() const noexcept { return p; }
+
+  /** Functions forwarded to the pool, see \p stack_pool. */
+  stack_type end() const noexcept { return p.end(); }
+  stack_type new_stack() const noexcept { return p.end(); }
+  bool empty(stack_type x) const noexcept { return p.empty(x); }
+  size_type psize() const noexcept { return p.psize(); }
+  const value_type& value(stack_type x) const { return p.value(x); }
+  stack_type next(stack_type x) const { return p.next(x); }
+  size_type ssize(stack_type x) const { return p.ssize(x); }
+  const value_type& reach(stack_type x, stack_type m) const { return p.reach(x, m); }
+
+  /** Function reserving n nodes in the pool and their reference counts. */
+  void reserve(size_type n){
+    p.reserve(n);
+    refs.reserve(n+1);
+  }
+
+  /** Function providing the number of nodes in at least a version, the distinct nodes. */
+  size_type live_nodes() const noexcept { return live; }
+
+  /** Function providing the number of references to a node: the heads held on it plus the nodes pushed on top of it.
+  * Throws if \p x is larger than \p psize().
+  * @param x index of a node
+  * @return the reference count, 0 for \p end() and free nodes
+  */
+  size_type use_count(stack_type x) const{
+    AP_ERROR_IN_RANGE(x, end(), stack_type(psize()));
+    return empty(x) ? 0 : refs[x];
+  }
+
+
+  //___________________Versions__________________________________________________//
+
+
+  /** Function copying a head, in O(1): the copy is a version of the stack that shares all its nodes.
+  * Throws if \p x is larger than \p psize() or if it is a free node.
+  * @param x head of a version
+  * @return the same head, to be released on its own
+  */
+  stack_type share(stack_type x){
+    if (!empty(x))
+      ++refs[_live(x)];
+    return x;
+  }
+
+  /** Functions pushing a value on a version, which becomes the next of the new node, see \p stack_pool::push().
+  * The reference held by \p head is taken over by the new node: to push on a version and keep it, \p share() it first.
+  * @param val value of the new node
+  * @param head head of the version, not to be used after the call unless shared
+  * @return the head of the new version
+  */
+  stack_type push(const value_type& val, stack_type head){
+    return _pushed(p.push(val, _checked(head)));
+  }
+  stack_type push(value_type&& val, stack_type head){
+    return _pushed(p.push(std::move(val), _checked(head)));
+  }
+
+  /** Function constructing a value in place on top of a version, see \p push(). */
+  template <typename... Args>
+  stack_type emplace(stack_type head, Args&&... args){
+    return _pushed(p.emplace(_checked(head), std::forward<Args>(args)...));
+  }
+
+  /** Function releasing the first node of a version and providing the version below.
+  * If no other version uses the node, it goes to free_nodes. \n
+  * Throws if \p x is \p end(), larger than \p psize() or a free node.
+  * @param x head of the version, not to be used after the call
+  * @return the head of the version below, held by the caller
+  */
+  stack_type pop(stack_type x){
+    AP_ERROR(!empty(x)) << "Cannot pop from an empty stack\n";
+    const auto n = p.next(_live(x));
+    if (--refs[x] == 0){
+      // the reference of x to n goes to the caller
+      p.pop(x);
+      --live;
+    }else if (!empty(n)){
+      ++refs[n];
+    }
+    return n;
+  }
+
+  /** Function releasing a whole version: its nodes are freed from the head on, up to the first node
+  * still used by another version. Takes O(number of freed nodes). \n
+  * Throws if \p x is larger than \p psize() or a free node.
+  * @param x head of the version, not to be used after the call
+  * @return \p end()
+  */
+  stack_type free_stack(stack_type x){
+    if (!empty(x))
+      _live(x);
+    while (!empty(x) && --refs[x] == 0){
+      const auto n = p.next(x);
+      p.pop(x);
+      --live;
+      x = n;
+    }
+    return end();
+  }
+
+
+ private:
+
+  /** Auxiliary function checking that \p x is end() or a node with references. */
+  stack_type _checked(stack_type x) const{
+    return empty(x) ? x : _live(x);
+  }
+
+  /** Auxiliary function checking that \p x is a node with references. */
+  stack_type _live(stack_type x) const{
+    AP_ERROR_IN_RANGE(x, stack_type(1), stack_type(psize()));
+    AP_ERROR(refs[x] > 0) << "Node " << x << " is free: the version was released\n";
+    return x;
+  }
+
+  /** Auxiliary function counting the first reference to a node just pushed, held by the caller. */
+  stack_type _pushed(stack_type x){
+    if (refs.size() <= x)
+      refs.resize(std::size_t(x)+1);
+    refs[x] = 1;
+    ++live;
+    return x;
+  }
+};
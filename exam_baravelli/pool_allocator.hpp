@@ -0,0 +1,207 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+
+/**
+*	@file pool_allocator.hpp
+*	@brief Header file: implementation of class pool_allocator, an allocator of fixed-size slots for node-based containers
+*/
+
+
+/**
+* Class \p slot_arena: the memory behind \p pool_allocator, slots of a few fixed sizes carved out of contiguous blocks.
+*
+* It recycles the slots as \p stack_pool recycles its nodes: each size has a free list, threaded through the free slots
+* themselves (the first bytes of a free slot hold the address of the next one), and a slot is taken from it if possible,
+* otherwise from the end of the last block, as a node is pushed at the end of the pool when free_nodes is empty.
+* A slot given back goes on top of its free list, both in O(1); the blocks are released only by the destructor. \n
+* The sizes are the multiples of \p granularity up to \p max_slot. A size has its own blocks, each one twice the previous,
+* from \p first_slots up to \p max_block_slots slots. \n
+* The arena is not thread safe: a container and its copies must stay in one thread, or be guarded by the user.
+*/
+class slot_arena{
+
+ public:
+  /** the sizes of the slots are multiples of granularity, enough to hold the link of the free list */
+  static constexpr std::size_t granularity = sizeof(void*);
+
+  /** the largest slot, larger requests go to \p ::operator new */
+  static constexpr std::size_t max_slot = 256;
+
+  /** number of slots of the first block of each size, and largest block */
+  static constexpr std::size_t first_slots = 64;
+  static constexpr std::size_t max_block_slots = std::size_t(1) << 16;
+
+  /** Function telling whether the arena serves \p bytes bytes aligned to \p align. */
+  static constexpr bool fits(std::size_t bytes, std::size_t align) noexcept{
+    return bytes <= max_slot && align <= alignof(std::max_align_t);
+  }
+
+  /** Function providing the size of the slot holding \p bytes bytes aligned to \p align:
+  * a multiple of both, so that every slot of a block aligned to \p std::max_align_t is aligned. */
+  static constexpr std::size_t slot_size(std::size_t bytes, std::size_t align) noexcept{
+    return _round_up(_round_up(bytes == 0 ? 1 : bytes, granularity), align);
+  }
+
+  slot_arena() = default;
+  slot_arena(const slot_arena&) = delete;
+  slot_arena& operator=(const slot_arena&) = delete;
+
+  ~slot_arena(){
+    for (auto b : blocks)
+      ::operator delete(b);
+  }
+
+  /** Function providing a slot of \p size bytes, a value of \p slot_size(). Throws \p std::bad_alloc if a block cannot be allocated. */
+  void* allocate(std::size_t size){
+    auto& c = classes[size/granularity - 1];
+    if (c.free != nullptr){
+      const auto s = c.free;
+      c.free = s->next;
+      return s;
+    }
+    if (c.cursor == c.limit)
+      _new_block(c, size);
+    const auto s = c.cursor;
+    c.cursor += size;
+    return s;
+  }
+
+  /** Function giving back a slot of \p size bytes, it goes on top of the free list of its size. */
+  void deallocate(void* p, std::size_t size) noexcept{
+    auto& c = classes[size/granularity - 1];
+    c.free = ::new (p) link{c.free};
+  }
+
+  /** Function providing the bytes taken by the blocks. */
+  std::size_t allocated_bytes() const noexcept { return bytes; }
+
+ private:
+  /** a free slot, holding the next one */
+  struct link{
+    link* next;
+  };
+
+  /** the slots of a size: free list, unused room of the last block, slots of the next block */
+  struct size_class{
+    link* free{nullptr};
+    char* cursor{nullptr};
+    char* limit{nullptr};
+    std::size_t next_slots{first_slots};
+  };
+
+  size_class classes[max_slot/granularity];
+  std::vector<void*> blocks;
+  std::size_t bytes{0};
+
+  static constexpr std::size_t _round_up(std::size_t n, std::size_t m) noexcept{
+    return (n + m - 1) / m * m;
+  }
+
+  /** Auxiliary function allocating the next block of a size, twice the previous one. */
+  void _new_block(size_class& c, std::size_t size){
+    blocks.reserve(blocks.size()+1);
+    const auto n = c.next_slots*size;
+    c.cursor = static_cast<char*>(::operator new(n));
+    c.limit = c.cursor + n;
+    blocks.push_back(c.cursor);
+    bytes += n;
+    if (c.next_slots < max_block_slots)
+      c.next_slots *= 2;
+  }
+};
+
+
+
+
+/**
+* Class \p pool_allocator: allocator of node-based containers (\p std::list, \p std::set, \p std::map, ...)
+* handing out the slots of a \p slot_arena.
+*
+* A node container allocates its nodes one at a time: each allocation of a single object that fits a slot
+* is served in O(1) from the free list of its size or from the end of a block, without calling \p ::operator new,
+* and the nodes end up side by side in the blocks. Arrays (\p n > 1), large and over-aligned types go to \p ::operator new. \n
+* The arena is shared by the copies of the allocator and by its rebinds, so the node allocator a container makes
+* from it uses the same arena, and two allocators compare equal if they share it. The arena lives as long as the last of
+* them, and the memory goes back to the system only then: a container that shrinks keeps its slots for the next insertions. \n
+* A default constructed allocator makes a new arena, so \p std::set<int, std::less<int>, pool_allocator<int>> has one
+* of its own; pass the same allocator to many containers to share one. The allocator follows the container
+* on copy and move assignment and on swap.
+* @tparam T type of the allocated objects
+*/
+template <typename T>
+class pool_allocator{
+
+  template <typename U> friend class pool_allocator;
+
+  /** the arena shared with the copies and the rebinds */
+  std::shared_ptr<slot_arena> arena;
+
+  /** Auxiliary function telling whether n objects go to the arena. */
+  static constexpr bool _pooled(std::size_t n) noexcept{
+    return n == 1 && slot_arena::fits(sizeof(T), alignof(T));
+  }
+
+  static constexpr std::size_t slot = slot_arena::slot_size(sizeof(T), alignof(T));
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  /** Default constructor, makes a new arena. */
+  pool_allocator() : arena{std::make_shared<slot_arena>()} {}
+
+  /** Custom constructor, sharing an existing arena. */
+  explicit pool_allocator(std::shared_ptr<slot_arena> a) noexcept : arena{std::move(a)} {}
+
+  /** Copy and move constructors and assignments: all of them copy the arena, a moved-from allocator must stay
+  * equal to the new one, since a container moves its allocator and may still be used afterwards. */
+  pool_allocator(const pool_allocator& other) noexcept : arena{other.arena} {}
+  pool_allocator(pool_allocator&& other) noexcept : arena{other.arena} {}
+  pool_allocator& operator=(const pool_allocator& other) noexcept { arena = other.arena; return *this; }
+  pool_allocator& operator=(pool_allocator&& other) noexcept { arena = other.arena; return *this; }
+
+  /** Converting constructor, the rebind shares the arena of \p other. */
+  template <typename U>
+  pool_allocator(const pool_allocator<U>& other) noexcept : arena{other.arena} {}
+
+  /** Function providing room for n objects, not constructed. Throws \p std::bad_alloc. */
+  T* allocate(std::size_t n){
+    if (_pooled(n))
+      return static_cast<T*>(arena->allocate(slot));
+    if (n > std::size_t(-1)/sizeof(T))
+      throw std::bad_alloc{};
+    return static_cast<T*>(::operator new(n*sizeof(T)));
+  }
+
+  /** Function giving back the room of n objects, provided by \p allocate(n). */
+  void deallocate(T* p, std::size_t n) noexcept{
+    if (_pooled(n))
+      arena->deallocate(p, slot);
+    else
+      ::operator delete(p);
+  }
+
+  /** Function providing the arena, e.g. to read \p allocated_bytes(). */
+  const std::shared_ptr<slot_arena>& get_arena() const noexcept { return arena; }
+
+  template <typename U>
+  friend bool operator==(const pool_allocator& a, const pool_allocator<U>& b) noexcept{
+    return a.get_arena() == b.get_arena();
+  }
+
+  template <typename U>
+  friend bool operator!=(const pool_allocator& a, const pool_allocator<U>& b) noexcept{
+    return !(a == b);
+  }
+};
+
+// definition of the static member, needed when it is odr-used before C++17
+template <typename T>
+constexpr std::size_t pool_allocator<T>::slot;
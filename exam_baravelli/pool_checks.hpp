@@ -0,0 +1,62 @@
+#pragma once
+#include "ap_error.hpp"
+
+
+/**
+*	@file pool_checks.hpp
+*	@brief Header file: checking policies deciding how stack_pool and _stack_iterator validate indexes
+*/
+
+
+/**
+* Checking policies for \p stack_pool and \p _stack_iterator.
+*
+* A policy is a class with the static functions \p in_range(x, lower, upper), validating an index,
+* and \p not_null(p), validating a pointer. Every access to a node goes through them
+* (\p value(), \p next(), the constructor and the increment of the iterators, \p push(), \p pop(), ...),
+* so the policy decides what a traversal costs:
+* - \p checked: always throw on a wrong index, the default
+* - \p debug_assert: throw only in debug builds, i.e. unless \p NDEBUG is defined (see \p AP_ASSERT)
+* - \p unchecked: never check, a traversal is a plain chase of the indexes
+*
+* The logical checks (popping from an empty handle, a compaction on a modified pool, ...) do not depend on the policy.
+*/
+
+
+/** Policy \p checked: every index is checked, a wrong one throws \p std::runtime_error. */
+struct checked{
+
+  template <typename X, typename Lower, typename Upper>
+  static void in_range(const X& x, const Lower& lower, const Upper& upper){
+    AP_ERROR_IN_RANGE(x, lower, upper);
+  }
+
+  static void not_null(const void* p){
+    AP_ERROR(p!=nullptr) << "The pointer to stack_pool points to no pool :( why did you do that? " << std::endl;
+  }
+};
+
+
+/** Policy \p debug_assert: the indexes are checked through \p AP_ASSERT, hence only when \p NDEBUG is not defined. */
+struct debug_assert{
+
+  template <typename X, typename Lower, typename Upper>
+  static void in_range(const X& x, const Lower& lower, const Upper& upper){
+    AP_ASSERT_IN_RANGE(x, lower, upper);
+  }
+
+  static void not_null(const void* p){
+    static_cast<void>(p); // unused when NDEBUG is defined
+    AP_ASSERT(p!=nullptr) << "The pointer to stack_pool points to no pool\n";
+  }
+};
+
+
+/** Policy \p unchecked: nothing is checked, a wrong index is undefined behaviour. */
+struct unchecked{
+
+  template <typename X, typename Lower, typename Upper>
+  static void in_range(const X&, const Lower&, const Upper&) noexcept {}
+
+  static void not_null(const void*) noexcept {}
+};
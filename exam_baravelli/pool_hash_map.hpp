@@ -0,0 +1,538 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "stack_pool.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file pool_hash_map.hpp
+*	@brief Header file: implementation of class pool_hash_map, a chained hash map whose buckets are stacks of a stack_pool
+*/
+
+
+/** Helper mapping any well-formed types to void, as \p std::void_t of C++17. */
+template <typename...>
+struct _make_void{ using type = void; };
+
+/** Trait telling whether both the hasher and the key comparison accept keys of other types (they define \p is_transparent). */
+template <typename H, typename E, typename = void>
+struct _transparent_lookup : std::false_type {};
+
+template <typename H, typename E>
+struct _transparent_lookup<H, E, typename _make_void<typename H::is_transparent, typename E::is_transparent>::type>
+  : std::true_type {};
+
+
+/**
+* Class \p _hash_map_iterator: forward iterator visiting all the values of a pool_hash_map, bucket by bucket.
+*
+* It holds the table it is in (the buckets still to be migrated come first during a rehash), the bucket
+* and the node. Two iterators are equal when they are at the same node, \p end() being node 0.
+*
+* @tparam V type of the values, const for a const iterator
+* @tparam M pool_hash_map type, const for a const iterator
+*/
+template <typename V, typename M>
+class _hash_map_iterator {
+
+  template <typename, typename> friend class _hash_map_iterator;
+  friend typename std::remove_const<M>::type;
+
+  using map_type = M;
+  using stack_type = typename std::remove_const<M>::type::stack_type;
+
+  /** Pointer to the map.*/
+  map_type* map_ptr;
+  /** Table of the bucket: 0 for the buckets being migrated, 1 for the current ones.*/
+  unsigned table;
+  /** Index of the bucket in its table.*/
+  std::size_t bucket;
+  /** Index of the node, 0 at the end.*/
+  stack_type index;
+
+  /** Auxiliary function moving to the first node of the next buckets if the current one is exhausted.*/
+  void skip_empty(){
+    while (index == 0){
+      const auto& t = map_ptr -> _table(table);
+      if (++bucket < t.size()){
+        index = t[bucket];
+      }else if (table == 0){
+        table = 1;
+        bucket = std::size_t(-1);
+      }else{
+        return;
+      }
+    }
+  }
+
+
+ public:
+  using value_type = typename std::remove_const<V>::type;
+  using reference = V&;
+  using pointer = V*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+
+  /** Custom constructor: iterator at node \p x of \p bucket in \p table, moving on if \p x is 0 and the table is not over.
+  * @param my_map pointer to the map
+  * @param t table of the bucket
+  * @param b index of the bucket
+  * @param x index of the node
+  */
+  _hash_map_iterator(map_type* my_map, unsigned t, std::size_t b, stack_type x) :
+    map_ptr{my_map},
+    table{t},
+    bucket{b},
+    index{x}{
+      skip_empty();
+    }
+
+  /** Converting constructor, from an iterator to a const iterator.*/
+  template <typename V2, typename M2, typename = typename std::enable_if<std::is_convertible<V2*, V*>::value>::type>
+  _hash_map_iterator(const _hash_map_iterator<V2, M2>& other) :
+    map_ptr{other.map_ptr},
+    table{other.table},
+    bucket{other.bucket},
+    index{other.index}{}
+
+  reference operator*() const {
+    return map_ptr -> _value(index);
+  }
+
+  pointer operator ->() const {
+    return &**this;
+  }
+
+  _hash_map_iterator& operator++() {
+    index = map_ptr -> _next(index);
+    skip_empty();
+    return *this;
+  }
+
+  _hash_map_iterator operator++(int) {
+    auto tmp = *this;
+    ++(*this);
+    return tmp;
+  }
+
+  friend bool operator==(const _hash_map_iterator& x, const _hash_map_iterator& y) {
+    return x.index == y.index;
+  }
+
+  friend bool operator!=(const _hash_map_iterator& x, const _hash_map_iterator& y) {
+    return !(x == y);
+  }
+};
+
+
+
+
+/**
+* Class \p pool_hash_map: hash map with separate chaining, where each bucket is a stack of a \p stack_pool.
+*
+* The buckets are the heads of the stacks, N-sized indexes in a vector, and the nodes of all the chains live in
+* one \p stack_pool: the whole table is two flat arrays, no node is allocated on its own and the removed ones are
+* recycled through free_nodes. A value is pushed on top of its bucket, and erasing it relinks its predecessor. \n
+* The number of buckets is a power of 2. The hash is mixed by a multiplication by the golden ratio, whose top bits
+* pick the bucket, so that the buckets of a table twice as large split each bucket of the old one in two. \n
+* Rehash is incremental: when the load factor would exceed \p max_load_factor(), the buckets are doubled and the old
+* array is kept. Each later insertion or erasure by key moves the nodes of at least \p rehash_step old buckets into the new
+* array, relinking indexes without copying values; lookups check the old bucket of a key until it has been moved.
+* With a small \p max_load_factor() more buckets are moved at a time, about 1/max_load_factor(), so that the migration
+* is always over before the next doubling, and no insertion pays the relinking of the whole map, only the allocation
+* of the new array. The exceptions are tiny tables, with less than about 2/max_load_factor() buckets: they double
+* at almost each insertion, moving all their few old buckets at once. \n
+* \p reserve() and \p rehash() instead rebuild the buckets at once. \n
+* Heterogeneous lookup: if both \p Hash and \p KeyEqual define \p is_transparent, \p find(), \p count(), \p contains(),
+* \p try_emplace() and \p operator[]() accept any key type the two of them accept, e.g. a string view or a C string for
+* std::string keys, and a Key is constructed only when a value is inserted. \n
+* Unlike \p std::unordered_map, the values move when the pool grows: pointers and references to them are invalidated
+* by insertions (unless enough room was reserved), and iterators by insertions and erasures.
+* The nodes are reached only from the buckets, never from indexes given by the user, so the checking policy defaults to \p unchecked.
+* @tparam Key type of the keys
+* @tparam T type of the mapped values
+* @tparam Hash hash function of the keys
+* @tparam KeyEqual equality of the keys
+* @tparam N stack/index type
+* @tparam L layout of the nodes in memory, see \p pool_layout.hpp
+* @tparam C checking policy of the indexes, see \p pool_checks.hpp
+* @tparam A allocator of the nodes
+* @tparam S statistics policy, see \p pool_stats.hpp
+*/
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>,
+          typename N = std::size_t, typename L = aos_layout, typename C = unchecked,
+          typename A = std::allocator<std::pair<const Key, T>>, typename S = no_stats>
+class pool_hash_map{
+
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using stack_type = N; // type of the indexes
+  using pool_type = stack_pool<value_type, N, L, C, A, S>;
+  using size_type = decltype(std::declval<const pool_type&>().psize());
+
+  using iterator = _hash_map_iterator<value_type, pool_hash_map>;
+  using const_iterator = _hash_map_iterator<const value_type, const pool_hash_map>;
+
+  /** true if the lookups accept keys of other types, see the class description */
+  static constexpr bool transparent = _transparent_lookup<Hash, KeyEqual>::value;
+
+  /** smallest number of old buckets moved by each insertion or erasure during a rehash */
+  static constexpr std::size_t rehash_step = 4;
+
+  /** smallest number of buckets */
+  static constexpr std::size_t min_buckets = 8;
+
+ private:
+  template <typename, typename> friend class _hash_map_iterator;
+
+  static constexpr unsigned digits = std::numeric_limits<std::size_t>::digits;
+  static constexpr std::size_t golden = digits == 64 ? std::size_t(0x9E3779B97F4A7C15ull) : std::size_t(0x9E3779B9u);
+
+  /** the pool holding the nodes of all the buckets */
+  pool_type p;
+
+  /** heads of the buckets */
+  std::vector<N> heads;
+
+  /** heads of the buckets being migrated during a rehash, empty otherwise; those before \p moved are already empty */
+  std::vector<N> old;
+  std::size_t moved{0};
+
+  /** log2 of the number of buckets */
+  unsigned bits;
+
+  /** number of values */
+  size_type n_values{0};
+  float max_load{1.0f};
+
+  /** number of old buckets moved by each insertion or erasure during the current rehash, see \p _grow() */
+  std::size_t step{rehash_step};
+  Hash hash;
+  KeyEqual eq;
+
+ public:
+
+  /** Default constructor, with \p min_buckets buckets. */
+  pool_hash_map() : pool_hash_map{0} {}
+
+  /** Custom constructor, with room for n values without rehashing.
+  * @param n number of values to reserve
+  * @param h hash function
+  * @param e equality of the keys
+  */
+  explicit pool_hash_map(size_type n, const Hash& h = Hash{}, const KeyEqual& e = KeyEqual{}) :
+    p{}, heads(min_buckets, N(0)), bits{_log2(min_buckets)}, hash{h}, eq{e} {
+    reserve(n);
+  }
+
+  /** Function providing the underlying pool, read only. */
+  const pool_type& pool() const noexcept { return p; }
+
+  size_type size() const noexcept { return n_values; }
+  bool empty() const noexcept { return n_values == 0; }
+  std::size_t bucket_count() const noexcept { return heads.size(); }
+  float load_factor() const noexcept { return float(n_values)/float(bucket_count()); }
+  float max_load_factor() const noexcept { return max_load; }
+
+  /** Function telling whether a rehash is in progress, i.e. some buckets of the old array are still to be moved. */
+  bool rehashing() const noexcept { return !old.empty(); }
+
+  /** Function setting the largest load factor, the buckets are doubled when it would be exceeded. Throws if \p ml is not positive. */
+  void max_load_factor(float ml){
+    AP_ERROR(ml > 0) << "The max load factor must be positive, not " << ml << "\n";
+    max_load = ml;
+  }
+
+  hasher hash_function() const { return hash; }
+  key_equal key_eq() const { return eq; }
+
+
+  //____________Iterators_Domain___________________________________________//
+
+
+  iterator begin() noexcept { return iterator{this, 0, std::size_t(-1), N(0)}; }
+  iterator end() noexcept { return iterator{this, 1, heads.size(), N(0)}; }
+  const_iterator begin() const noexcept { return cbegin(); }
+  const_iterator end() const noexcept { return cend(); }
+  const_iterator cbegin() const noexcept { return const_iterator{this, 0, std::size_t(-1), N(0)}; }
+  const_iterator cend() const noexcept { return const_iterator{this, 1, heads.size(), N(0)}; }
+
+
+  //___________________Lookup____________________________________________________//
+
+
+  /** Functions looking for the value of a key, walking its bucket.
+  * @param k the key, or with a transparent hasher any key they accept
+  * @return iterator to the value, \p end() if there is none
+  */
+  iterator find(const Key& k){ return _find<iterator>(this, k); }
+  const_iterator find(const Key& k) const{ return _find<const_iterator>(this, k); }
+
+  template <typename K, typename M = pool_hash_map, typename = typename std::enable_if<M::transparent>::type>
+  iterator find(const K& k){ return _find<iterator>(this, k); }
+  template <typename K, typename M = pool_hash_map, typename = typename std::enable_if<M::transparent>::type>
+  const_iterator find(const K& k) const{ return _find<const_iterator>(this, k); }
+
+  /** Functions counting the values of a key, 0 or 1. */
+  size_type count(const Key& k) const{ return contains(k) ? 1 : 0; }
+  template <typename K, typename M = pool_hash_map, typename = typename std::enable_if<M::transparent>::type>
+  size_type count(const K& k) const{ return contains(k) ? 1 : 0; }
+
+  bool contains(const Key& k) const{ return find(k) != end(); }
+  template <typename K, typename M = pool_hash_map, typename = typename std::enable_if<M::transparent>::type>
+  bool contains(const K& k) const{ return find(k) != end(); }
+
+  /** Functions providing the mapped value of a key. Throw if the key is not in the map. */
+  T& at(const Key& k){ return _at(find(k)); }
+  const T& at(const Key& k) const{ return _at(find(k)); }
+
+
+  //___________________Insert_and_Erase__________________________________________//
+
+
+  /** Function inserting a value with key \p k if there is none, the mapped value constructed in place from \p args.
+  * The key is looked up as it is, see the class description, and turned into a Key only if the value is inserted.
+  * Throws through the construction of the value, the map is unchanged in that case.
+  * @param k the key
+  * @param args arguments forwarded to the constructor of T
+  * @return iterator to the value of \p k and true if it was inserted
+  */
+  template <typename K, typename... Args>
+  std::pair<iterator, bool> try_emplace(K&& k, Args&&... args){
+    _migrate(step);
+    const auto& key = _lookup_key(k, std::integral_constant<bool, transparent || std::is_same<typename std::decay<K>::type, Key>::value>{});
+    const auto m = _mix(key);
+    auto it = _find_in<iterator>(this, m, key);
+    if (it != end())
+      return {it, false};
+    if (n_values+1 > max_load*bucket_count())
+      _grow();
+    const auto s = _slot(m);
+    auto& head = _table(s.first)[s.second];
+    head = p.emplace(head, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(k)),
+                     std::forward_as_tuple(std::forward<Args>(args)...));
+    ++n_values;
+    return {iterator{this, s.first, s.second, head}, true};
+  }
+
+  /** Functions inserting a value if its key is not in the map, see \p try_emplace(). */
+  std::pair<iterator, bool> insert(const value_type& v){ return try_emplace(v.first, v.second); }
+  std::pair<iterator, bool> insert(value_type&& v){ return try_emplace(v.first, std::move(v.second)); }
+
+  /** Function providing the mapped value of a key, inserted value initialized if the key is not in the map. */
+  template <typename K>
+  T& operator[](K&& k){ return try_emplace(std::forward<K>(k)).first->second; }
+
+  /** Function removing the value of a key, if any.
+  * @param k the key
+  * @return the number of values removed, 0 or 1
+  */
+  size_type erase(const Key& k){
+    _migrate(step);
+    const auto s = _slot(_mix(k));
+    auto& head = _table(s.first)[s.second];
+    for (N prev = 0, x = head; x != 0; prev = x, x = p.next(x)){
+      if (eq(p.value(x).first, k)){
+        _unlink(head, prev, x);
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  /** Function removing the value at \p pos, which must be a valid iterator of the map. No rehash step is done.
+  * @param pos iterator to the value
+  * @return iterator to the value after it
+  */
+  iterator erase(const_iterator pos){
+    AP_ERROR(pos != cend()) << "Cannot erase end()\n";
+    iterator after{this, pos.table, pos.bucket, pos.index};
+    ++after;
+    auto& head = _table(pos.table)[pos.bucket];
+    N prev = 0;
+    for (auto x = head; x != pos.index; x = p.next(x))
+      prev = x;
+    _unlink(head, prev, pos.index);
+    return after;
+  }
+
+  /** Function removing all the values, the buckets and the room in the pool stay. */
+  void clear(){
+    finish_rehash();
+    for (auto& h : heads)
+      h = p.free_stack(h);
+    n_values = 0;
+  }
+
+
+  //___________________Rehash____________________________________________________//
+
+
+  /** Function moving all the remaining old buckets, ending a rehash in progress. */
+  void finish_rehash(){
+    _migrate(old.size());
+  }
+
+  /** Function rebuilding the buckets at once, with at least \p n of them and enough for the load factor.
+  * The nodes are relinked into the new buckets, no value is copied or moved.
+  * @param n smallest number of buckets
+  */
+  void rehash(std::size_t n){
+    finish_rehash();
+    std::size_t b = min_buckets;
+    while (b < n || n_values > max_load*b)
+      b *= 2;
+    if (b == heads.size())
+      return;
+    old.swap(heads);
+    heads.assign(b, N(0));
+    bits = _log2(b);
+    moved = 0;
+    _migrate(old.size());
+  }
+
+  /** Function making room for n values: the pool reserves n nodes and the buckets are rebuilt
+  * so that n values do not exceed the load factor.
+  * @param n number of values
+  */
+  void reserve(size_type n){
+    p.reserve(n);
+    rehash(std::size_t(float(n)/max_load + 0.5f));
+  }
+
+
+ private:
+
+  static unsigned _log2(std::size_t n) noexcept{
+    unsigned b = 0;
+    while ((std::size_t(1) << b) < n)
+      ++b;
+    return b;
+  }
+
+  /** Auxiliary functions for the iterators. */
+  const std::vector<N>& _table(unsigned t) const noexcept { return t == 0 ? old : heads; }
+  std::vector<N>& _table(unsigned t) noexcept { return t == 0 ? old : heads; }
+  value_type& _value(N x){ return p.value(x); }
+  const value_type& _value(N x) const{ return p.value(x); }
+  N _next(N x) const{ return p.next(x); }
+
+  /** Auxiliary function mixing the hash of a key, its top bits pick the bucket. */
+  template <typename K>
+  std::size_t _mix(const K& k) const{
+    return std::size_t(hash(k)) * golden;
+  }
+
+  /** Auxiliary function providing the table and the bucket of a mixed hash: the old bucket if it was not moved yet. */
+  std::pair<unsigned, std::size_t> _slot(std::size_t m) const noexcept{
+    if (!old.empty()){
+      const auto j = m >> (digits - bits + 1);
+      if (j >= moved)
+        return {0, j};
+    }
+    return {1, m >> (digits - bits)};
+  }
+
+  /** Auxiliary functions walking the bucket of a key. */
+  template <typename I, typename Self, typename K>
+  static I _find(Self* self, const K& k){
+    return _find_in<I>(self, self -> _mix(k), k);
+  }
+
+  template <typename I, typename Self, typename K>
+  static I _find_in(Self* self, std::size_t m, const K& k){
+    const auto s = self -> _slot(m);
+    for (auto x = self -> _table(s.first)[s.second]; x != 0; x = self -> p.next(x))
+      if (self -> eq(self -> p.value(x).first, k))
+        return I{self, s.first, s.second, x};
+    return self -> end();
+  }
+
+  /** Auxiliary functions providing the key to look up: the given one if it can be, a Key otherwise. */
+  template <typename K>
+  static const K& _lookup_key(const K& k, std::true_type) noexcept { return k; }
+  template <typename K>
+  static Key _lookup_key(const K& k, std::false_type) { return Key(k); }
+
+  /** Auxiliary function providing the mapped value of an iterator found by \p at(), throws at \p end(). */
+  template <typename I>
+  static auto& _at(I it){
+    AP_ERROR(it.index != 0) << "The key is not in the map\n";
+    return it -> second;
+  }
+
+  /** Auxiliary function removing the node \p x, after \p prev in the bucket of \p head, and giving it to free_nodes. */
+  void _unlink(N& head, N prev, N x){
+    const auto n = p.pop(x);
+    if (prev == 0)
+      head = n;
+    else
+      p.next(prev) = n;
+    --n_values;
+  }
+
+  /** Auxiliary function doubling the buckets, the old ones are moved a few at a time by \p _migrate().
+  * The step is chosen so that the insertions before the one doubling again move all of them. */
+  void _grow(){
+    finish_rehash();
+    std::vector<N> bigger(heads.size()*2, N(0));
+    old.swap(heads);
+    heads.swap(bigger);
+    ++bits;
+    moved = 0;
+    const auto next = std::size_t(max_load*bucket_count()); // size at which the next insertion doubles again
+    const auto calls = next > n_values+1 ? next - n_values - 1 : 1;
+    step = std::max(rehash_step, (old.size() + calls - 1) / calls);
+  }
+
+  /** Auxiliary function moving the nodes of up to \p k old buckets into the new ones, relinking their indexes.
+  * The old array is released when all its buckets are moved. */
+  void _migrate(std::size_t k){
+    if (old.empty())
+      return;
+    for (; k > 0 && moved < old.size(); --k, ++moved){
+      for (auto x = old[moved]; x != 0;){
+        const auto n = p.next(x);
+        auto& h = heads[_mix(p.value(x).first) >> (digits - bits)];
+        p.next(x) = h;
+        h = x;
+        x = n;
+      }
+      old[moved] = 0;
+    }
+    if (moved == old.size()){
+      std::vector<N>{}.swap(old);
+      moved = 0;
+    }
+  }
+};
+
+// definitions of the static members, needed when they are odr-used before C++17
+template <typename Key, typename T, typename H, typename E, typename N, typename L, typename C, typename A, typename S>
+constexpr bool pool_hash_map<Key, T, H, E, N, L, C, A, S>::transparent;
+
+template <typename Key, typename T, typename H, typename E, typename N, typename L, typename C, typename A, typename S>
+constexpr std::size_t pool_hash_map<Key, T, H, E, N, L, C, A, S>::rehash_step;
+
+template <typename Key, typename T, typename H, typename E, typename N, typename L, typename C, typename A, typename S>
+constexpr std::size_t pool_hash_map<Key, T, H, E, N, L, C, A, S>::min_buckets;
+
+template <typename Key, typename T, typename H, typename E, typename N, typename L, typename C, typename A, typename S>
+constexpr unsigned pool_hash_map<Key, T, H, E, N, L, C, A, S>::digits;
+
+template <typename Key, typename T, typename H, typename E, typename N, typename L, typename C, typename A, typename S>
+constexpr std::size_t pool_hash_map<Key, T, H, E, N, L, C, A, S>::golden;
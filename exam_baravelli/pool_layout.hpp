@@ -0,0 +1,534 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/**
+*	@file pool_layout.hpp
+*	@brief Header file: layout policies deciding how stack_pool stores its nodes
+*/
+
+
+/**
+* Layout policies for \p stack_pool.
+*
+* A layout is a class with a nested template \p storage<T,N,A>, the container of the nodes of the pool,
+* allocating its memory through the allocator A (rebound with \p std::allocator_traits to what it actually stores).
+* The storage is indexed with the real (0-based) position of a node, \p stack_pool takes care of the + 1,
+* and must provide:
+* - a default constructor and a constructor taking the allocator, and \p get_allocator()
+* - \p value(i) and \p next(i), both const and non-const, not checked
+* - \p emplace_back(next, args...), adding a node at the end, its value constructed in place from args
+* - \p construct(i, args...) and \p destroy(i), constructing and destroying the value of an existing node,
+*   and \p alive(i), telling whether node i carries a value (always true if the liveness is not tracked)
+* - \p size(), \p capacity(), \p reserve(n)
+* - \p truncate(n), destroying the nodes from position n on, and \p shrink_to_fit(), giving back unused memory
+* - \p allocated_bytes(), the memory held by the storage
+*
+* The value of a free node is destroyed, so that the resources it holds are released when it is popped;
+* see \p node_value for how the storages keep track of it.
+*/
+
+
+/** Tag selecting the constructor of \p node_value that builds the value in place. */
+struct in_place_value_t{
+  explicit in_place_value_t() = default;
+};
+
+
+/**
+* Class \p node_value: raw room for a value of type T inside a node, constructed and destroyed on demand.
+*
+* For trivially copyable types destroying a value is a no-op and copying raw bytes is fine, so nothing
+* is tracked and the class has the same size of T. Otherwise a flag records whether the value is alive,
+* and copying, moving and destroying a \p node_value act on the value only if it is: containers of nodes
+* (\p std::vector included) can then copy, relocate and destroy the nodes without knowing which are free.
+* @tparam T type of the value
+*/
+template <typename T, bool = std::is_trivially_copyable<T>::value>
+class node_value{
+
+  union{ T v; };
+
+ public:
+  node_value() noexcept {}
+
+  /** Custom constructor building the value in place from \p args. */
+  template <typename... Args>
+  explicit node_value(in_place_value_t, Args&&... args)
+    : v(std::forward<Args>(args)...) {}
+
+  /** Function constructing the value in place from \p args. */
+  template <typename... Args>
+  void construct(Args&&... args){
+    ::new (static_cast<void*>(std::addressof(v))) T(std::forward<Args>(args)...);
+  }
+
+  void destroy() noexcept {}
+  bool alive() const noexcept { return true; }
+
+  T& get() noexcept { return v; }
+  const T& get() const noexcept { return v; }
+};
+
+
+template <typename T>
+class node_value<T, false>{
+
+  union{ T v; };
+  bool engaged{false};
+
+ public:
+  node_value() noexcept {}
+
+  /** Custom constructor building the value in place from \p args. */
+  template <typename... Args>
+  explicit node_value(in_place_value_t, Args&&... args)
+    : v(std::forward<Args>(args)...),
+      engaged{true} {}
+
+  node_value(const node_value& other)
+    : node_value() {
+    if (other.engaged)
+      construct(other.v);
+  }
+
+  node_value(node_value&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    : node_value() {
+    if (other.engaged)
+      construct(std::move(other.v));
+  }
+
+  node_value& operator=(const node_value& other){
+    if (this != &other){
+      destroy();
+      if (other.engaged)
+        construct(other.v);
+    }
+    return *this;
+  }
+
+  node_value& operator=(node_value&& other) noexcept(std::is_nothrow_move_constructible<T>::value){
+    if (this != &other){
+      destroy();
+      if (other.engaged)
+        construct(std::move(other.v));
+    }
+    return *this;
+  }
+
+  ~node_value() noexcept { destroy(); }
+
+  /** Function constructing the value in place from \p args, the previous one must have been destroyed. */
+  template <typename... Args>
+  void construct(Args&&... args){
+    ::new (static_cast<void*>(std::addressof(v))) T(std::forward<Args>(args)...);
+    engaged = true;
+  }
+
+  /** Function destroying the value, if alive. */
+  void destroy() noexcept {
+    if (engaged){
+      v.~T();
+      engaged = false;
+    }
+  }
+
+  bool alive() const noexcept { return engaged; }
+
+  T& get() noexcept { return v; }
+  const T& get() const noexcept { return v; }
+};
+
+
+/**
+* Layout \p aos_layout: array of structures, the original layout of \p stack_pool.
+*
+* Each node is a \p node_t carrying the value and the index of the next node, stored in a single \p std::vector.
+* The value and the link of a node share the same cache line, the best choice when the values are small
+* and are read at every step of the traversal.
+*/
+struct aos_layout{
+
+  /**
+  * @tparam T type of the values carried by each node
+  * @tparam N stack/index type
+  * @tparam A allocator, rebound to \p node_t
+  */
+  template <typename T, typename N, typename A = std::allocator<T>>
+  class storage{
+
+    /** Class \p node_t, implementing the concept of node of a stack*/
+    struct node_t{
+      /** value of type T carried by the node, destroyed when the node is free */
+      node_value<T> value;
+
+      /** index to the next node, type N */
+      N next;
+
+
+      /** Custom constructor: initializes \p next and constructs the value in place from \p args.
+      * Throws through the constructor of T.
+      * @param index index of the next node
+      * @param args arguments forwarded to the constructor of T
+      */
+      template <typename... Args>
+      explicit node_t(N index, Args&&... args)
+        :value{in_place_value_t{}, std::forward<Args>(args)...},
+         next{std::move(index)}
+         {}
+
+    };
+
+    using node_allocator = typename std::allocator_traits<A>::template rebind_alloc<node_t>;
+
+    /**std::vector of nodes, the support of the pool.*/
+    std::vector<node_t, node_allocator> nodes;
+
+   public:
+    using size_type = typename std::vector<node_t, node_allocator>::size_type;
+
+    storage() = default;
+    explicit storage(const A& a) : nodes(node_allocator(a)) {}
+
+    A get_allocator() const { return A(nodes.get_allocator()); }
+
+    T& value(size_type i) noexcept { return nodes[i].value.get(); }
+    const T& value(size_type i) const noexcept { return nodes[i].value.get(); }
+
+    N& next(size_type i) noexcept { return nodes[i].next; }
+    const N& next(size_type i) const noexcept { return nodes[i].next; }
+
+    /** Function adding a node at the end, its value built in place.
+    * Throws through \p std::vector<node_t>::emplace_back(...) and the constructor of T.
+    * @param n index of the next node
+    * @param args arguments forwarded to the constructor of T
+    */
+    template <typename... Args>
+    void emplace_back(N n, Args&&... args){
+      nodes.emplace_back(n, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void construct(size_type i, Args&&... args) { nodes[i].value.construct(std::forward<Args>(args)...); }
+    void destroy(size_type i) noexcept { nodes[i].value.destroy(); }
+    bool alive(size_type i) const noexcept { return nodes[i].value.alive(); }
+
+    size_type size() const noexcept { return nodes.size(); }
+    size_type capacity() const noexcept { return nodes.capacity(); }
+    void reserve(size_type n) { nodes.reserve(n); }
+
+    void truncate(size_type n) { nodes.erase(nodes.begin() + n, nodes.end()); }
+    void shrink_to_fit() { nodes.shrink_to_fit(); }
+    size_type allocated_bytes() const noexcept { return nodes.capacity() * sizeof(node_t); }
+  };
+};
+
+
+/**
+* Layout \p soa_layout: structure of arrays.
+*
+* The links and the values are stored in two separate \p std::vector, so the index array is dense:
+* walking a stack without reading its values (\p ssize(), \p _last_jump(), any traversal-only code)
+* touches only \p sizeof(N) bytes per node, instead of dragging every value through the cache.
+* It also removes the padding between a value and its link (e.g. 8 bytes per node become 6 for
+* \p T=int, \p N=uint16_t). The price is a second cache miss when both the link and the value are needed.
+*/
+struct soa_layout{
+
+  /**
+  * @tparam T type of the values carried by each node
+  * @tparam N stack/index type
+  * @tparam A allocator, rebound to N and to \p node_value<T>
+  */
+  template <typename T, typename N, typename A = std::allocator<T>>
+  class storage{
+
+    using traits = std::allocator_traits<A>;
+    using index_allocator = typename traits::template rebind_alloc<N>;
+    using value_allocator = typename traits::template rebind_alloc<node_value<T>>;
+
+    /**Links of the nodes, the dense index array.*/
+    std::vector<N, index_allocator> nexts;
+
+    /**Values of the nodes, in the same order of \p nexts.*/
+    std::vector<node_value<T>, value_allocator> values;
+
+   public:
+    using size_type = typename std::vector<N, index_allocator>::size_type;
+
+    storage() = default;
+    explicit storage(const A& a) : nexts(index_allocator(a)), values(value_allocator(a)) {}
+
+    A get_allocator() const { return A(nexts.get_allocator()); }
+
+    T& value(size_type i) noexcept { return values[i].get(); }
+    const T& value(size_type i) const noexcept { return values[i].get(); }
+
+    N& next(size_type i) noexcept { return nexts[i]; }
+    const N& next(size_type i) const noexcept { return nexts[i]; }
+
+    /** Function adding a node at the end, its value built in place.
+    * Throws through \p std::vector::emplace_back(...) and the constructor of T,
+    * leaving the two arrays with the same size.
+    * @param n index of the next node
+    * @param args arguments forwarded to the constructor of T
+    */
+    template <typename... Args>
+    void emplace_back(N n, Args&&... args){
+      values.emplace_back(in_place_value_t{}, std::forward<Args>(args)...);
+      try{
+        nexts.push_back(n);
+      }catch(...){
+        values.pop_back();
+        throw;
+      }
+    }
+
+    template <typename... Args>
+    void construct(size_type i, Args&&... args) { values[i].construct(std::forward<Args>(args)...); }
+    void destroy(size_type i) noexcept { values[i].destroy(); }
+    bool alive(size_type i) const noexcept { return values[i].alive(); }
+
+    size_type size() const noexcept { return nexts.size(); }
+    size_type capacity() const noexcept {
+      return std::min<size_type>(nexts.capacity(), values.capacity());
+    }
+    void reserve(size_type n) {
+      nexts.reserve(n);
+      values.reserve(n);
+    }
+
+    void truncate(size_type n) {
+      nexts.erase(nexts.begin() + n, nexts.end());
+      values.erase(values.begin() + n, values.end());
+    }
+    void shrink_to_fit() {
+      nexts.shrink_to_fit();
+      values.shrink_to_fit();
+    }
+    size_type allocated_bytes() const noexcept {
+      return nexts.capacity() * sizeof(N) + values.capacity() * sizeof(node_value<T>);
+    }
+  };
+};
+
+
+/**
+* Layout \p segmented_layout: array of structures split in fixed-size blocks that are never relocated.
+*
+* Nodes are \p node_t like in \p aos_layout, but they are stored in blocks of 2^B nodes, allocated one at a time
+* when the previous one is full. Growing the pool never moves a node: there is no reallocation spike and no
+* moment in which the old and the new buffer coexist, and the references returned by \p stack_pool<T,N>::value()
+* stay valid for the whole life of the node. The position of a node is split in a block number
+* (a shift) and an offset in the block (a mask). \n
+* \p reserve(n) allocates the blocks needed to hold n nodes, \p capacity() is the number of nodes of the allocated blocks.
+* The blocks come one at a time from the allocator, which is the natural match for arenas and huge pages.
+* @tparam B base 2 logarithm of the number of nodes in a block
+*/
+template <unsigned B = 12>
+struct segmented_layout{
+
+  /**
+  * @tparam T type of the values carried by each node
+  * @tparam N stack/index type
+  * @tparam A allocator, rebound to \p node_t for the blocks and to \p node_t* for their directory;
+  * its pointer type must be a plain pointer
+  */
+  template <typename T, typename N, typename A = std::allocator<T>>
+  class storage{
+
+    /** Class \p node_t, implementing the concept of node of a stack*/
+    struct node_t{
+      /** value of type T carried by the node, destroyed when the node is free */
+      node_value<T> value;
+
+      /** index to the next node, type N */
+      N next;
+
+      /** Custom constructor: initializes \p next and constructs the value in place from \p args. */
+      template <typename... Args>
+      explicit node_t(N index, Args&&... args)
+        :value{in_place_value_t{}, std::forward<Args>(args)...},
+         next{std::move(index)}
+         {}
+
+      node_t(const node_t&) = default;
+    };
+
+    using node_allocator = typename std::allocator_traits<A>::template rebind_alloc<node_t>;
+    using traits = std::allocator_traits<node_allocator>;
+    using block_allocator = typename traits::template rebind_alloc<node_t*>;
+
+   public:
+    using size_type = std::size_t;
+
+   private:
+    /** number of nodes in a block */
+    static constexpr size_type block_size = size_type(1) << B;
+
+    /** mask extracting the offset in a block from a position */
+    static constexpr size_type mask = block_size - 1;
+
+    node_allocator alloc;
+
+    /** Blocks of raw memory, only the first \p _size nodes are constructed. */
+    std::vector<node_t*, block_allocator> blocks;
+
+    /** Number of constructed nodes. */
+    size_type _size{0};
+
+    node_t& node(size_type i) noexcept { return blocks[i >> B][i & mask]; }
+    const node_t& node(size_type i) const noexcept { return blocks[i >> B][i & mask]; }
+
+    /** Function destroying every node and releasing every block. */
+    void clear() noexcept{
+      for (size_type i=0; i<_size; ++i)
+        traits::destroy(alloc, &node(i));
+      for (auto b : blocks)
+        traits::deallocate(alloc, b, block_size);
+      blocks.clear();
+      _size = 0;
+    }
+
+    /** Function copying the nodes of \p other one by one in new blocks (free nodes stay without value).
+    * If something throws, the storage is left empty. */
+    void copy_nodes(const storage& other){
+      try{
+        reserve(other._size);
+        for (; _size<other._size; ++_size)
+          traits::construct(alloc, &node(_size), other.node(_size));
+      }catch(...){
+        clear();
+        throw;
+      }
+    }
+
+    /** Function stealing the blocks of \p other, whose allocator must be able to release them. */
+    void steal_nodes(storage& other) noexcept{
+      blocks = std::move(other.blocks);
+      _size = other._size;
+      other.blocks.clear();
+      other._size = 0;
+    }
+
+    /** Functions replacing the allocator on assignment, only if it propagates (see \p std::allocator_traits). */
+    void propagate(const node_allocator& a, std::true_type) { alloc = a; }
+    void propagate(const node_allocator&, std::false_type) noexcept {}
+
+   public:
+    storage() = default;
+    explicit storage(const A& a) : alloc(a), blocks(block_allocator(a)) {}
+
+    A get_allocator() const { return A(alloc); }
+
+    /** Copy constructor, copies the nodes in new blocks, from the allocator selected by \p std::allocator_traits. */
+    storage(const storage& other)
+      : alloc{traits::select_on_container_copy_construction(other.alloc)},
+        blocks(block_allocator(alloc)) {
+      copy_nodes(other);
+    }
+
+    /** Move constructor, steals the blocks together with the allocator. */
+    storage(storage&& other) noexcept
+      : alloc{std::move(other.alloc)},
+        blocks(block_allocator(alloc)) {
+      steal_nodes(other);
+    }
+
+    /** Copy assignment, the allocator is replaced only if it propagates on copy assignment.
+    * If the copy throws, the storage is left empty. */
+    storage& operator=(const storage& other){
+      if (this != &other){
+        clear();
+        propagate(other.alloc, typename traits::propagate_on_container_copy_assignment{});
+        copy_nodes(other);
+      }
+      return *this;
+    }
+
+    /** Move assignment: the blocks are stolen if the allocator propagates on move assignment or if the two
+    * allocators are equal, otherwise the nodes are copied in blocks of the current allocator. */
+    storage& operator=(storage&& other){
+      if (this != &other){
+        clear();
+        if (traits::propagate_on_container_move_assignment::value || alloc == other.alloc){
+          propagate(other.alloc, typename traits::propagate_on_container_move_assignment{});
+          steal_nodes(other);
+        }else{
+          copy_nodes(other);
+        }
+      }
+      return *this;
+    }
+
+    ~storage() noexcept { clear(); }
+
+    T& value(size_type i) noexcept { return node(i).value.get(); }
+    const T& value(size_type i) const noexcept { return node(i).value.get(); }
+
+    N& next(size_type i) noexcept { return node(i).next; }
+    const N& next(size_type i) const noexcept { return node(i).next; }
+
+    /** Function adding a node at the end, allocating a new block if the last one is full.
+    * The value is built in place. Throws if the allocation or the construction of the value throw,
+    * leaving the storage unchanged.
+    * @param n index of the next node
+    * @param args arguments forwarded to the constructor of T
+    */
+    template <typename... Args>
+    void emplace_back(N n, Args&&... args){
+      reserve(_size + 1);
+      traits::construct(alloc, &node(_size), n, std::forward<Args>(args)...);
+      ++_size;
+    }
+
+    template <typename... Args>
+    void construct(size_type i, Args&&... args) { node(i).value.construct(std::forward<Args>(args)...); }
+    void destroy(size_type i) noexcept { node(i).value.destroy(); }
+    bool alive(size_type i) const noexcept { return node(i).value.alive(); }
+
+    size_type size() const noexcept { return _size; }
+    size_type capacity() const noexcept { return blocks.size() * block_size; }
+
+    /** Function allocating the blocks needed to hold n nodes. Existing nodes are never moved. */
+    void reserve(size_type n){
+      while (capacity() < n){
+        auto b = traits::allocate(alloc, block_size);
+        try{
+          blocks.push_back(b);
+        }catch(...){
+          traits::deallocate(alloc, b, block_size);
+          throw;
+        }
+      }
+    }
+
+    /** Function destroying the nodes from position n on, their blocks are kept. */
+    void truncate(size_type n) noexcept{
+      for (size_type i=n; i<_size; ++i)
+        traits::destroy(alloc, &node(i));
+      _size = n;
+    }
+
+    /** Function releasing the blocks holding no node. */
+    void shrink_to_fit() noexcept{
+      const auto needed = (_size + mask) >> B;
+      while (blocks.size() > needed){
+        traits::deallocate(alloc, blocks.back(), block_size);
+        blocks.pop_back();
+      }
+      blocks.shrink_to_fit();
+    }
+
+    /** Function providing the memory held by the blocks and by their directory. */
+    size_type allocated_bytes() const noexcept {
+      return capacity() * sizeof(node_t) + blocks.capacity() * sizeof(node_t*);
+    }
+  };
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+
+
+/**
+*	@file pool_stats.hpp
+*	@brief Header file: statistics policies deciding what stack_pool counts about its own use
+*/
+
+
+/**
+* Statistics policies for \p stack_pool.
+*
+* The pool reports every event to a member of type S, through the functions
+* - \p push(hit): a node was pushed, reusing a free node if \p hit is true, at the end of the pool otherwise
+* - \p pop(n): n nodes were popped
+* - \p grow(old_capacity, new_capacity): the storage may have been reallocated (or extended by a block)
+* - \p free_stack(): a stack was freed
+* - \p walk(n): n nodes were walked to reach the end of a free stack (\p _last_jump())
+*
+* and \p for_each(f) calls \p f(name, value) for each counter, to dump them.
+* \p no_stats, the default, does nothing: its functions are empty and inlined away, so the pool costs the same
+* as without statistics. \p pool_stats keeps the counters.
+*/
+
+
+/** Policy \p no_stats: nothing is counted. */
+struct no_stats{
+  void push(bool) noexcept {}
+  void pop(std::size_t) noexcept {}
+  void grow(std::size_t, std::size_t) noexcept {}
+  void free_stack() noexcept {}
+  void walk(std::size_t) noexcept {}
+
+  template <typename F>
+  void for_each(F&&) const noexcept {}
+};
+
+
+/** Policy \p pool_stats: plain counters of the events of the pool. */
+struct pool_stats{
+  /** nodes pushed, \p free_hits + \p free_misses */
+  std::size_t pushes{0};
+  /** nodes popped */
+  std::size_t pops{0};
+  /** pushes served by a free node */
+  std::size_t free_hits{0};
+  /** pushes that appended a node at the end of the pool */
+  std::size_t free_misses{0};
+  /** times the capacity of the storage grew: reallocations of \p std::vector, new blocks, extents of a file */
+  std::size_t reallocations{0};
+  /** calls to \p free_stack() */
+  std::size_t free_stacks{0};
+  /** nodes walked to find the end of a free stack */
+  std::size_t walked_nodes{0};
+
+  void push(bool hit) noexcept{
+    ++pushes;
+    ++(hit ? free_hits : free_misses);
+  }
+  void pop(std::size_t n) noexcept { pops += n; }
+  void grow(std::size_t old_capacity, std::size_t new_capacity) noexcept{
+    if (new_capacity > old_capacity)
+      ++reallocations;
+  }
+  void free_stack() noexcept { ++free_stacks; }
+  void walk(std::size_t n) noexcept { walked_nodes += n; }
+
+  /** Function calling \p f(name, value) for each counter, in the order of declaration. */
+  template <typename F>
+  void for_each(F&& f) const{
+    f("pushes", pushes);
+    f("pops", pops);
+    f("free_hits", free_hits);
+    f("free_misses", free_misses);
+    f("reallocations", reallocations);
+    f("free_stacks", free_stacks);
+    f("walked_nodes", walked_nodes);
+  }
+
+  /** Function providing the fraction of pushes served by a free node, 0 if nothing was pushed. */
+  double hit_rate() const noexcept{
+    return pushes == 0 ? 0. : double(free_hits) / double(pushes);
+  }
+
+  /** Function setting every counter back to 0. */
+  void reset() noexcept { *this = pool_stats{}; }
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "stack_pool.hpp"
+#include "ap_error.hpp"
+
+
+/**
+*	@file queue_pool.hpp
+*	@brief Header file: implementation of class queue_pool, the FIFO sibling of stack_pool
+*/
+
+
+/**
+* Class \p queue_pool: pool of queues, data structures compliant with the FirstInFirstOut rule.
+*
+* The queues live in a \p stack_pool: same storage (one contiguous vector with the default layout),
+* same 1-based indexes with 0 as \p end(), same recycling of the removed nodes through free_nodes. A queue is
+* a chain of nodes going from its front (the oldest value) to its back, hence it is walked in FIFO order
+* by the iterators of the pool. \n
+* A queue is identified by a \p queue, the \p handle of \p stack_pool: front, back and length. Knowing the back,
+* \p push_back() links the new node after it in O(1), while \p pop_front() is the \p pop() of a stack;
+* \p concat() links two queues and \p free_queue() gives a whole queue to free_nodes, both in O(1). \n
+* Each function takes the current \p queue of a queue and returns the updated one, which replaces it:
+* as for the heads of \p stack_pool, using an outdated \p queue corrupts the pool.
+* @tparam T type of the values carried by each node
+* @tparam N stack/index type
+* @tparam L layout of the nodes in memory, see \p pool_layout.hpp
+* @tparam C checking policy of the indexes, see \p pool_checks.hpp
+* @tparam A allocator of the nodes
+* @tparam S statistics policy, see \p pool_stats.hpp
+*/
+template <typename T, typename N = std::size_t, typename L = aos_layout, typename C = checked,
+          typename A = std::allocator<T>, typename S = no_stats>
+class queue_pool{
+
+ public:
+  using value_type = T; // type of the values
+  using stack_type = N; // type of the indexes
+  using pool_type = stack_pool<T, N, L, C, A, S>;
+  using size_type = decltype(std::declval<const pool_type&>().psize());
+
+  /** A queue: \p head is its front, \p tail its back and \p length the number of values. */
+  using queue = typename pool_type::handle;
+
+  using iterator = typename pool_type::iterator;
+  using const_iterator = typename pool_type::const_iterator;
+
+ private:
+  /** the pool holding the nodes */
+  pool_type p;
+
+ public:
+
+  /** Default constructor, the pool is empty. */
+  queue_pool() = default;
+
+  /** Custom constructor reserving n nodes.
+  * @param n number of nodes to reserve
+  */
+  explicit queue_pool(size_type n) : p(n) {}
+
+  /** Function providing the underlying pool, read only. */
+  const pool_type& pool() const noexcept { return p; }
+
+  /** Function providing an empty queue. */
+  queue new_queue() const noexcept { return queue{p.end(), 0, p.end()}; }
+
+  bool empty(const queue& q) const noexcept { return p.empty(q.head); }
+  size_type size(const queue& q) const noexcept { return q.length; }
+
+  /** Functions forwarded to the pool, see \p stack_pool. */
+  void reserve(size_type n){ p.reserve(n); }
+  size_type capacity() const noexcept { return p.capacity(); }
+  size_type psize() const noexcept { return p.psize(); }
+
+
+  //____________Iterators_Domain___________________________________________//
+
+
+  /** Functions providing the iterators walking a queue from the front to the back.
+  * Throw if the front of \p q is larger than \p psize().
+  */
+  iterator begin(const queue& q){ return p.begin(q.head); }
+  iterator end(const queue& q){ return p.end(q.head); }
+  const_iterator begin(const queue& q) const{ return p.cbegin(q.head); }
+  const_iterator end(const queue& q) const{ return p.cend(q.head); }
+  const_iterator cbegin(const queue& q) const{ return p.cbegin(q.head); }
+  const_iterator cend(const queue& q) const{ return p.cend(q.head); }
+
+
+  //___________________Access____________________________________________________//
+
+
+  /** Functions providing the oldest value of a queue. Throw if the queue is empty. */
+  T& front(const queue& q){ return p.value(_not_empty(q).head); }
+  const T& front(const queue& q) const{ return p.value(_not_empty(q).head); }
+
+  /** Functions providing the newest value of a queue. Throw if the queue is empty. */
+  T& back(const queue& q){ return p.value(_not_empty(q).tail); }
+  const T& back(const queue& q) const{ return p.value(_not_empty(q).tail); }
+
+
+  //___________________FInally_Use_The_Pool_______________________________________//
+
+
+  /** Functions adding a value at the back of a queue, in O(1).
+  * The node is taken from free_nodes if possible, as in \p stack_pool::push(). Throws if the back of \p q
+  * is larger than \p psize() or through the copy of the value; the queue is unchanged in that case.
+  * @param val value of the new node
+  * @param q current queue
+  * @return the queue after adding the value
+  */
+  queue push_back(const T& val, const queue& q){
+    return _linked(p.push(val, p.end()), q);
+  }
+  queue push_back(T&& val, const queue& q){
+    return _linked(p.push(std::move(val), p.end()), q);
+  }
+
+  /** Function adding a value at the back of a queue, constructed in place from \p args.
+  * @param q current queue
+  * @param args arguments forwarded to the constructor of T
+  * @return the queue after adding the value
+  */
+  template <typename... Args>
+  queue emplace_back(const queue& q, Args&&... args){
+    return _linked(p.emplace(p.end(), std::forward<Args>(args)...), q);
+  }
+
+  /** Function removing the value at the front of a queue, in O(1); the node goes to free_nodes.
+  * Throws if the queue is empty.
+  * @param q current queue
+  * @return the queue after removing the value
+  */
+  queue pop_front(const queue& q){
+    return p.pop(_not_empty(q));
+  }
+
+  /** Function appending the values of \p b to the back of \p a, in O(1): the back of \p a is linked to the front of \p b.
+  * The two queues must be different; both are no longer valid after the call.
+  * @param a the queue coming first
+  * @param b the queue coming after
+  * @return the joined queue
+  */
+  queue concat(const queue& a, const queue& b){
+    return p.splice(a, b);
+  }
+
+  /** Function removing all the values of a queue, the whole chain goes to free_nodes in O(1)
+  * (plus the destruction of the values if T is not trivially destructible).
+  * @param q current queue
+  * @return an empty queue
+  */
+  queue free_queue(const queue& q){
+    return p.free_stack(q);
+  }
+
+
+ private:
+
+  /** Auxiliary function checking that a queue is not empty. */
+  const queue& _not_empty(const queue& q) const{
+    AP_ERROR(!empty(q)) << "The queue is empty\n";
+    return q;
+  }
+
+  /** Auxiliary function linking a new node after the back of a queue; the node is given back if the back is out of range. */
+  queue _linked(stack_type x, const queue& q){
+    if (empty(q))
+      return queue{x, 1, x};
+    try{
+      p.next(q.tail) = x;
+    }catch(...){
+      p.pop(x);
+      throw;
+    }
+    return queue{q.head, q.length+1, x};
+  }
+};
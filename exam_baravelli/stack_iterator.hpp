@@ -2,7 +2,7 @@
 #include <iostream>
 #include <utility>
 #include <iterator>
-#include "ap_error.hpp"
+#include "pool_checks.hpp"
 
 
 /**
@@ -18,8 +18,9 @@
 * @tparam T type of the values carried by each node.
 * @tparam N stack/index type
 * @tparam S_P stack_pool type, templating the function on the type it's supposed to work on
+* @tparam C checking policy of the constructor, the same of the pool (see \p pool_checks.hpp)
 */
-template <typename T, typename N, typename S_P >
+template <typename T, typename N, typename S_P, typename C = checked>
 class _stack_iterator {
 
   using pool_type = S_P;
@@ -43,15 +44,16 @@ class _stack_iterator {
   * Throws if my_pool is of type pool_type but points to nothing. Don't do that! \n
   * Given the previous does not happen, throws if the index is not in the pool, hence
   * larger than \p pool_ptr -> psize() since up to size() all nodes belong to a stack or to free_nodes,
-  * hence could be successfully used to build an iterator
+  * hence could be successfully used to build an iterator. \n
+  * Both checks are made through the policy C, and vanish for \p unchecked
   * @param x index value
   * @param my_pool pointer to the stack_pool, it's a constant pointer
   */
   _stack_iterator(stack_type x, pool_type* const my_pool) :
     pool_ptr{my_pool},
     index{std::move(x)}{
-      AP_ERROR(pool_ptr!=nullptr) << "The pointer to stack_pool points to no pool :( why did you do that? "<< std::endl;
-      AP_ERROR_IN_RANGE(x, (*pool_ptr).end(), (*pool_ptr).psize());
+      C::not_null(pool_ptr);
+      C::in_range(index, (*pool_ptr).end(), (*pool_ptr).psize());
     }
 
 
@@ -134,3 +136,118 @@ class _stack_iterator {
 
 };
 
+
+
+
+/**
+* Class \p _prefetch_iterator: iterator walking a stack of a stack_pool one node ahead.
+*
+* \p _stack_iterator can ask for the next node only once it is incremented, so on a fragmented pool each
+* increment waits for a whole cache miss. This iterator keeps the index of the node after the current one,
+* and asks the pool to prefetch it (see \p stack_pool<T,N>::prefetch()): the miss on the next node overlaps
+* with whatever is done with the current value. It has the interface of \p _stack_iterator.
+*
+* @tparam T type of the values carried by each node.
+* @tparam N stack/index type
+* @tparam S_P stack_pool type
+* @tparam C checking policy of the constructor, the same of the pool (see \p pool_checks.hpp)
+*/
+template <typename T, typename N, typename S_P, typename C = checked>
+class _prefetch_iterator {
+
+  using pool_type = S_P;
+  using stack_type = N;
+
+  /** Pointer to stack_pool, will store the passed pool address.*/
+  pool_type* pool_ptr;
+  /** Index of the current node.*/
+  stack_type index;
+  /** Index of the node after the current one, already prefetched.*/
+  stack_type ahead;
+
+
+  /** Auxiliary function reading the node after the current one and prefetching it.*/
+  void look_ahead(){
+    ahead = index == pool_ptr -> end() ? index : pool_ptr -> next(index);
+    pool_ptr -> prefetch(ahead);
+  }
+
+
+ public:
+  using value_type = T;
+  using reference = value_type&;
+  using pointer = value_type*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+
+  /** Custom constructor: initializes \p pool_ptr and \p index with the passed values, and prefetches the next node.
+  * Throws like the constructor of \p _stack_iterator.
+  * @param x index value
+  * @param my_pool pointer to the stack_pool, it's a constant pointer
+  */
+  _prefetch_iterator(stack_type x, pool_type* const my_pool) :
+    pool_ptr{my_pool},
+    index{std::move(x)}{
+      C::not_null(pool_ptr);
+      C::in_range(index, (*pool_ptr).end(), (*pool_ptr).psize());
+      look_ahead();
+    }
+
+
+  /** Dereference operator, see \p _stack_iterator::operator*().
+  * @return value of the node at index
+  */
+  reference operator*() const {
+    return pool_ptr -> value(index);
+  }
+
+
+  /** Reference operator.
+  * @return address of the value of the node at index (pointer)
+  */
+  pointer operator ->() const {
+    return &**this;
+  }
+
+
+  /** PreIncrement: moves to the node ahead, whose line was already requested, and prefetches the following one.
+  * @return the incremented iterator
+  */
+  _prefetch_iterator& operator++() {
+    index = ahead;
+    look_ahead();
+    return *this;
+  }
+
+
+  /** PostIncrement: increments.
+  * @return the iterator before the increment
+  */
+  _prefetch_iterator operator++(int) {
+    auto tmp = *this;
+    ++(*this);
+    return tmp;
+  }
+
+
+  /** Equality operator overload.
+  * @param x reference to an iterator
+  * @param y reference to another iterator
+  * @return a boolean: true (iterators at the same node) or false (iterators at different nodes)
+  */
+  friend bool operator==(const _prefetch_iterator& x, const _prefetch_iterator& y) {
+    return x.index == y.index;
+  }
+
+
+  /** Inequality operator overload.
+  * @param x reference to an iterator
+  * @param y reference to another iterator
+  * @return a boolean: false (iterators at the same node) or true (iterators at different nodes)
+  */
+  friend bool operator!=(const _prefetch_iterator& x, const _prefetch_iterator& y) {
+    return !(x == y);
+  }
+
+};
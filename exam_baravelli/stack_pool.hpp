@@ -1,8 +1,15 @@
 #pragma once
+#include <functional>
 #include <iostream>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <iterator>
+#include <limits>
 #include <vector>
+#include "pool_checks.hpp"
+#include "pool_layout.hpp"
+#include "pool_stats.hpp"
 #include "stack_iterator.hpp"
 #include "ap_error.hpp"
 
@@ -23,14 +30,13 @@
 * The proposed implementation employs an std::vector as support of the pool,
 * exploiting its indexing to provide a simple yet effective identification method for
 * nodes and stacks: each node will be identified by its index on the vector + 1,
-* each stack by its first node's index, referred to as head. \n The nodes themselves
-* are objects of type node: nested in the \p stack_pool it's in fact implemented the
-* class representing the concept of node, \p node_t, a simple structure carrying a value and the
-* index of the next node. The nested implementation of the class \p node_t was the most sensible
-* choice due to its templates being the same of \p stack_pool, along with its reduced size
-* and close connection with the latter. \n Going back to templates, \p stack_pool  has two
+* each stack by its first node's index, referred to as head. \n How the nodes themselves
+* are stored is decided by a layout policy (see \p pool_layout.hpp): by default each node is
+* a \p node_t, a simple structure carrying a value and the index of the next node, while
+* \p soa_layout keeps the values and the indexes in two separate arrays, so that walking a stack
+* touches only the dense array of indexes. \n Going back to templates, \p stack_pool  has three
 * templates, allowing the user to choose the desired type for both
-* the values carried by the nodes and their indexes. \n Also, the aim is building a
+* the values carried by the nodes and their indexes, and the layout. \n Also, the aim is building a
 * blazingly fast data structure and to this end the implementations tries to
 * mitigate two common bottlenecks caused by the slow, slow memory: the allocation
 * of the elements one by one and the distance between them. The first issue
@@ -58,56 +64,33 @@
 *   - large types: larger pool, since the correct implementation of the pool is possible as long as there are enough indexes to represent the nodes
 * @tparam T type of the values carried by each node
 * @tparam N stack/index type
+* @tparam L layout of the nodes in memory, \p aos_layout (default, value and next side by side),
+* \p soa_layout (values and nexts in two separate arrays) or \p segmented_layout<B> (blocks of nodes
+* that are never relocated), see \p pool_layout.hpp
+* @tparam C checking policy of the indexes, \p checked (default, always throw on a wrong index),
+* \p debug_assert (throw unless NDEBUG is defined) or \p unchecked (no check, traversals are a plain
+* chase of the indexes), see \p pool_checks.hpp
+* @tparam A allocator of the nodes, used through \p std::allocator_traits (rebound by the layout to what it
+* stores), e.g. a \p std::pmr::polymorphic_allocator on an arena or on a huge-page resource
+* @tparam S statistics policy, \p no_stats (default, nothing is counted and nothing is paid) or \p pool_stats
+* (counters of pushes, pops, free list hits, ...), see \p pool_stats.hpp
 */
 
-template <typename T, typename N = std::size_t>
+template <typename T, typename N = std::size_t, typename L = aos_layout, typename C = checked,
+          typename A = std::allocator<T>, typename S = no_stats>
 class stack_pool{
 
-  /** Class \p node_t, implementing the concept of node of a stack*/
-  struct node_t{
-    /** value of type T carried by the node */
-    T value;
-
-    /** index to the next node, type N */
-    N next;
-
-
-    /** Custom constructor taking l-value: initializes \p value and \p index with the passed values.
-    * Does not throw: upstream checks done by \p stack_pool<T,N>::_push(), which is the only one able to call it
-    * @param v const reference to the value the node will carry
-    * @param index index of the next node
-    */
-    node_t(const T& v, N index) noexcept
-      :value{v},
-       next{std::move(index)}
-       {}
-
-
-    /** Custom constructor taking r-value: initializes \p value and \p index with the passed values.
-    * Does not throw: upstream checks done by \p stack_pool<T,N>::_push(), which is the only one able to call it
-    * @param v r-value, indicating the value the node will carry
-    * @param index index of the next node
-    */
-    node_t(T&& v, N index) noexcept
-      :value{std::move(v)},
-       next{std::move(index)}
-       {}
-
-
-    /**Default destructor, explicitly = default*/
-    ~node_t()noexcept = default;
-
-  };
-
   using value_type = T; // type of the values
   using stack_type = N; // type of the stacks indexes
-  using size_type = typename std::vector<node_t>::size_type; //"type suitable for holding the size of the vector"
-  using pool_type = stack_pool<value_type, stack_type>;
+  using storage_type = typename L::template storage<value_type, stack_type, A>; // container of the nodes
+  using size_type = typename storage_type::size_type; //"type suitable for holding the size of the vector"
+  using pool_type = stack_pool<value_type, stack_type, L, C, A, S>;
+  using index_allocator = typename std::allocator_traits<A>::template rebind_alloc<stack_type>;
 
 
-  /**std::vector of nodes, the support of the pool.
-   * Initialized by the default constructor of vector */
-  std::vector<node_t> pool;
+  /**Storage of the nodes, the support of the pool, laid out as chosen by the policy L.
+   * Initialized by its default constructor */
+  storage_type pool;
 
 
   /**Stack of free nodes.
@@ -117,31 +100,95 @@ class stack_pool{
   stack_type free_nodes;
 
 
+  /**Freed stacks waiting to become free_nodes.
+   * \p free_stack() does not link the freed stack to free_nodes, since that requires
+   * reaching the last node of one of the two; the head of the freed stack is parked here instead,
+   * and becomes free_nodes as soon as the latter is exhausted. Hence free_nodes and the segments
+   * together form the free list. Always empty when compiled with -DSTACK_POOL_WALK_FREE_LIST*/
+  std::vector<stack_type, index_allocator> free_segments;
+
+
+  /**Counters of the events of the pool, see \p pool_stats.hpp. Empty with \p no_stats.*/
+  S counters;
+
+
 
  public:
 
+  /** Class \p handle: a stack head that also carries the length and the last node of the stack.
+  * It is an optional alternative to the plain head: \p push(), \p pop() and \p free_stack()
+  * taking a handle keep it up to date, so that \p ssize() is O(1), \p reach() walks at most once,
+  * and \p free_stack() links the whole stack to free_nodes without any walk. \n
+  * A default constructed handle is an empty stack. Do not mix the two interfaces on the same stack:
+  * pushing on \p h.head through the plain interface leaves \p h outdated.
+  */
+  struct handle{
+    /** head of the stack, exactly the plain index */
+    stack_type head;
+    /** number of nodes of the stack */
+    size_type length;
+    /** last node of the stack, \p end() when the stack is empty */
+    stack_type tail;
+  };
+
+  using allocator_type = A;
+
   /**Default constructor, sets free_nodes as empty. */
   stack_pool() noexcept
     : free_nodes{end()}{}
 
 
+  /** Custom constructor taking the allocator the nodes will come from, sets free_nodes as empty.
+  * @param alloc allocator of the nodes
+  */
+  explicit stack_pool(const allocator_type& alloc)
+    : pool{alloc},
+      free_nodes{end()},
+      free_segments(index_allocator(alloc)){}
+
+
   /** Custom constructor, reserves n nodes in the pool, sets free_nodes as empty.
   * Notice, the nodes are reserved but not constructed. Reserving nodes allows
   * to avoid reallocation each time the capacity of the vector is reached. \n
   * \p std::vector<T>::reserve(...) throws in case insufficient memory is available
   * @param n number of nodes to reserve
+  * @param alloc allocator of the nodes
   */
-  explicit stack_pool(size_type n)
-    : stack_pool()
+  explicit stack_pool(size_type n, const allocator_type& alloc = allocator_type())
+    : stack_pool(alloc)
     {pool.reserve(n);}
 
 
+  /** Custom constructor opening a persistent pool, available only for layouts backed by a file (\p mapped_layout).
+  * The pool stored in \p path is mapped as it is, together with its free_nodes: no node is read
+  * until it is used. If the file does not exist, an empty pool is created. \n
+  * Throws through the constructor of the storage if the file cannot be used.
+  * @param path the file backing the pool
+  */
+  explicit stack_pool(const std::string& path)
+    : pool{path},
+      free_nodes{pool.saved_free_nodes()}{}
+
+
+  /** Default copy and move semantics, provided that the layout is copyable/movable. */
+  stack_pool(const stack_pool&) = default;
+  stack_pool(stack_pool&&) = default;
+  stack_pool& operator=(const stack_pool&) = default;
+  stack_pool& operator=(stack_pool&&) = default;
+
+
+  /** Destructor: for persistent layouts the free list is saved in the file, see \p sync().*/
+  ~stack_pool() noexcept{
+    _close(pool, 0);
+  }
+
+
 
 
   //____________Iterators_Domain___________________________________________//
 
-  using iterator = _stack_iterator<value_type, stack_type, pool_type>;
-  using const_iterator = _stack_iterator<const value_type, stack_type, const pool_type>;
+  using iterator = _stack_iterator<value_type, stack_type, pool_type, C>;
+  using const_iterator = _stack_iterator<const value_type, stack_type, const pool_type, C>;
 
 
   /** Function providing the iterator to the first element of the stack.
@@ -210,6 +257,30 @@ class stack_pool{
     }
 
 
+  using prefetch_iterator = _prefetch_iterator<value_type, stack_type, pool_type, C>;
+  using const_prefetch_iterator = _prefetch_iterator<const value_type, stack_type, const pool_type, C>;
+
+
+  /** Functions providing the prefetching iterators to the first element of the stack and to its end, see \p _prefetch_iterator.
+  * They walk the stack like \p begin() and \p end(), one node ahead.
+  * Throw through the constructor of _prefetch_iterator<> if the given index is larger than \p psize()
+  * @param x head of the stack
+  * @return prefetching iterator to the first element
+  */
+  prefetch_iterator pbegin(stack_type x){
+    return prefetch_iterator{x, this};
+  }
+  prefetch_iterator pend(stack_type ){
+    return prefetch_iterator{end(), this};
+  }
+  const_prefetch_iterator pbegin(stack_type x) const{
+    return const_prefetch_iterator{x, this};
+  }
+  const_prefetch_iterator pend(stack_type ) const{
+    return const_prefetch_iterator{end(), this};
+  }
+
+
 
   //____________Get_To_Know_The_Pool______________________________________//
 
@@ -230,45 +301,73 @@ class stack_pool{
   }
 
 
+  /** Function providing the handle of a new empty stack.
+  * @return handle of the empty new stack, its head is \p end()
+  */
+  handle new_handle() noexcept{
+    return handle{end(), 0, end()};
+  }
+
+
+  /** Function building the handle of an existing stack.
+  * The stack is walked once to count its nodes and find the last one. \n
+  * The function throws through \p next() if \p x is larger than \p psize().
+  * @param x head of the stack
+  * @return handle of the stack
+  */
+  handle make_handle(stack_type x) const{
+    handle h{x, 0, end()};
+    for (; !empty(x); x=next(x)){
+      h.tail = x;
+      ++h.length;
+    }
+    return h;
+  }
+
+
   /** Function providing access to the node value at the given index.
   * The function throws if the given index is equal to \p end() or larger than \p psize(), since at these indexes there is no value at all
+  * The check is made through the checking policy C, see \p pool_checks.hpp
   * @param x index of a node
   * @return reference to the value of the node identified by \p x
   */
   T& value(stack_type x){
-    AP_ERROR_IN_RANGE(x, end(), psize());
-    return node(x).value;
+    C::in_range(x, stack_type(1), psize());
+    return pool.value(x-1);
   }
 
   /** Constant function providing access to the node value at the given index.
   * The function throws if the given index is equal to \p end() or larger than \p psize(), since at these indexes there is no value at all
+  * The check is made through the checking policy C, see \p pool_checks.hpp
   * @param x index of a node
   * @return constant reference to the value of the node identified by \p x
   */
   const T& value(stack_type x) const{
-    AP_ERROR_IN_RANGE(x, end(), psize());
-    return node(x).value;
+    C::in_range(x, stack_type(1), psize());
+    return pool.value(x-1);
   }
 
 
   /** Function providing access to the node next element at the given index.
   * The function throws if the given index is equal to \p end() or larger than \p psize(), since at these indexes there is no next at all
+  * The check is made through the checking policy C, see \p pool_checks.hpp
   * @param x index of a node
   * @return reference to the next index of the node identified by \p x
   */
   stack_type& next(stack_type x){
-    AP_ERROR_IN_RANGE(x, end(), psize());
-    return node(x).next;
+    C::in_range(x, stack_type(1), psize());
+    return pool.next(x-1);
   }
 
   /** Constant function providing access to the node next element at the given index.
   * The function throws if the given index is equal to \p end() or larger than \p psize(), since at these indexes there is no next at all
+  * The check is made through the checking policy C, see \p pool_checks.hpp
   * @param x index of a node
   * @return constant reference to the next index of the node identified by \p x
   */
   const stack_type& next(stack_type x) const{
-    AP_ERROR_IN_RANGE(x, end(), psize());
-    return node(x).next;
+    C::in_range(x, stack_type(1), psize());
+    return pool.next(x-1);
   }
 
 
@@ -278,7 +377,9 @@ class stack_pool{
   * @param n number of required nodes
   */
   void reserve(size_type n){
+    const auto cap = pool.capacity();
     pool.reserve(n);
+    counters.grow(cap, pool.capacity());
   }
 
 
@@ -291,6 +392,62 @@ class stack_pool{
   }
 
 
+  /** Function providing a copy of the allocator of the nodes. */
+  allocator_type get_allocator() const{
+    return pool.get_allocator();
+  }
+
+
+  /** Function providing the memory held by the storage of the nodes, in bytes.
+  * It does not count the small vector of parked freed stacks.
+  * @return the bytes allocated for the nodes, used or not
+  */
+  size_type allocated_bytes() const noexcept{
+    return pool.allocated_bytes();
+  }
+
+
+  /** Function giving back the memory not needed by the nodes in use, e.g. after a peak of load.
+  * The free nodes at the end of the pool are dropped, the remaining free nodes are linked again in a single
+  * free_nodes list (in increasing order, so that the next pushes fill the pool from the front), and the storage
+  * is shrunk: \p std::vector reallocates to the new size, \p segmented_layout releases the empty blocks and
+  * \p mapped_layout truncates the file. \n
+  * The nodes in use never move, so every head and handle stays valid; only the free nodes in the middle
+  * of the pool stay allocated, see \p compact() to get rid of them too. \n
+  * Takes O(psize()) time and psize() bits of auxiliary memory. Throws if the auxiliary memory cannot be
+  * allocated, leaving the pool unchanged, or through the storage.
+  * @return the number of bytes released
+  */
+  size_type shrink_to_fit(){
+    const auto before = pool.allocated_bytes();
+    std::vector<bool> is_free(psize()+1, false);
+    const auto mark = [this, &is_free](stack_type x){
+      for (; !empty(x); x=pool.next(x-1))
+        is_free[x] = true;
+    };
+    mark(free_nodes);
+    for (auto x : free_segments)
+      mark(x);
+
+    auto n = psize();
+    while (n > 0 && is_free[n])
+      --n;
+    free_nodes = end();
+    free_segments.clear();
+    for (auto x = static_cast<stack_type>(n); x > 0; --x){
+      if (is_free[x]){
+        pool.next(x-1) = free_nodes;
+        free_nodes = x;
+      }
+    }
+
+    pool.truncate(n);
+    pool.shrink_to_fit();
+    const auto after = pool.allocated_bytes();
+    return before > after ? before - after : 0;
+  }
+
+
   /** Function allowing to assess the current size of the pool.
   * Notice that the size of the pool is the sum of the nodes in the stacks and in free_nodes. \n
   * It does not throw since \p std::vector<T>::size() is no-throw guaranteed. \n
@@ -310,6 +467,13 @@ class stack_pool{
     return (x==end());
   }
 
+  /** Overloaded function allowing to assess whether the stack of the given handle is empty or not.
+  * @return true if the stack is empty, false if it's not
+  */
+  bool empty(const handle& h) const noexcept{
+    return empty(h.head);
+  }
+
 
 
   //___________________FInally_Use_The_Pool_______________________________________//
@@ -317,30 +481,74 @@ class stack_pool{
 
 
   /** Function taking l-value references able to add a node to the stack.
-  * Calls the auxiliary function \p _push(), and throws through it.
+  * Calls the auxiliary function \p _emplace(), and throws through it.
   * @param val constant reference to the value of the new node
   * @param head current head of the stack, will be the next of the new node
   * @return the new head of the stack after adding the new node
   */
   stack_type push(const T& val, stack_type head){
-    return _push(val, head);
+    return _emplace(head, val);
   }
 
   /** Function taking r-value references able to add a node to the stack.
-  * Calls the auxiliary function \p _push(), and throws through it.
+  * Calls the auxiliary function \p _emplace(), and throws through it.
   * @param val r-value reference to the value of the new node
   * @param head current head of the stack, will be the next of the new node
   * @return the new head of the stack after adding the new node
   */
   stack_type push(T&& val, stack_type head){
-    return _push(std::move(val), head);
+    return _emplace(head, std::move(val));
+  }
+
+  /** Overloaded function taking l-value references able to add a node to the stack of a handle.
+  * Calls the auxiliary function \p _emplace(), and throws through it.
+  * @param val constant reference to the value of the new node
+  * @param h current handle of the stack
+  * @return the handle of the stack after adding the new node
+  */
+  handle push(const T& val, const handle& h){
+    return _emplace_handle(h, val);
+  }
+
+  /** Overloaded function taking r-value references able to add a node to the stack of a handle.
+  * Calls the auxiliary function \p _emplace(), and throws through it.
+  * @param val r-value reference to the value of the new node
+  * @param h current handle of the stack
+  * @return the handle of the stack after adding the new node
+  */
+  handle push(T&& val, const handle& h){
+    return _emplace_handle(h, std::move(val));
+  }
+
+
+  /** Function adding a node to the stack, its value constructed in place from \p args.
+  * No temporary T is built: the value is constructed directly in the reused free node or in the new node
+  * at the end of the pool, so T needs neither to be default constructible nor assignable. \n
+  * Calls the auxiliary function \p _emplace(), and throws through it; if the constructor of T throws the pool is unchanged.
+  * @param head current head of the stack, will be the next of the new node
+  * @param args arguments forwarded to the constructor of T
+  * @return the new head of the stack after adding the new node
+  */
+  template <typename... Args>
+  stack_type emplace(stack_type head, Args&&... args){
+    return _emplace(head, std::forward<Args>(args)...);
+  }
+
+  /** Overloaded function adding a node to the stack of a handle, its value constructed in place from \p args.
+  * @param h current handle of the stack
+  * @param args arguments forwarded to the constructor of T
+  * @return the handle of the stack after adding the new node
+  */
+  template <typename... Args>
+  handle emplace(const handle& h, Args&&... args){
+    return _emplace_handle(h, std::forward<Args>(args)...);
   }
 
 
   /** Function that deleted the first node of the given stack.
   * The function takes the head of the stack as a parameter and pops the first element. \b Be \b careful,
   * if an index different from a head is supplied to the function a node imbetween the stack will be deleted! \n
-  * The removed node is added to free_nodes. \n
+  * The removed node is added to free_nodes and its value is destroyed. \n
   * The function works by assigning to free_nodes the original head, to the original head the original next element of the first
   * node, and to the latter the original free_nodes.
   * See \p supplementary_materials \n
@@ -350,36 +558,667 @@ class stack_pool{
   */
   stack_type pop(stack_type x){
     _new_first(free_nodes, x);
+    pool.destroy(free_nodes-1);
+    counters.pop(1);
     return x;
   }
 
+  /** Overloaded function that deletes the first node of the stack of a handle.
+  * Same as \p pop(stack_type), the length and the tail of the handle are updated. \n
+  * The function throws if the stack is empty.
+  * @param h handle of the stack
+  * @return the handle of the stack after removing the first node
+  */
+  handle pop(const handle& h){
+    AP_ERROR(!empty(h)) << "Cannot pop from an empty stack\n";
+    return handle{pop(h.head), h.length-1, h.length==1 ? end() : h.tail};
+  }
+
 
   /** Function that deletes an entire stack.
   * The function takes the head of the stack as a parameter and sets the stack to \n end(). \b Be \b careful,
   * if an index different from a head is supplied to the function the portion of stack up to the pointed node will be deleted! \n
-  * The removed stack is added to free_nodes. \n
+  * The removed stack is added to the free list in constant time, whatever the length of the stack and of free_nodes:
   * - If free_nodes is empty, the function simply works by assigning it to head before setting the latter to \p end()
-  * - If free_nodes is not empty, the auxiliary function \p _last_jump() is called, returning the next element of the last
-  * node and assigning it to head, before setting the latter to \p end(); the choice of reaching the end of free_nodes
-  * instead of the one of the given stack and do the opposite procedure is due to the fact that free_nodes is bound to
-  * shrink, while stacks to increase, so in the majority of the cases free_nodes should be shorter than the stacks,
-  * which is relevant since we have to travel up to its last node.
-//  * See \p supplementary_materials \n
+  * - If free_nodes is not empty, the head is parked in \p free_segments, and the stack will become free_nodes
+  * once the current one is used up by \p _emplace().
+  *
+  * The values of the stack are destroyed: if T is not trivially destructible this takes a walk of the stack,
+  * since the resources held by the values must be released now.
+  *
+  * When compiled with -DSTACK_POOL_WALK_FREE_LIST the original behaviour is kept instead: the auxiliary function
+  * \p _last_jump() walks free_nodes up to its last node, whose next becomes the freed head. It costs a walk of
+  * the whole free list for each freed stack.
+  * See \p supplementary_materials \n
   * The function throws if \p x is larger than \p psize() since assigning to free nodes an index not pointing to nodes
   * would not makes sense and would cause troubles with free_nodes.
   * @param head of the stack, index of the stack to remove
   * @return the new head of the freed stack, always \p end()
   */
   stack_type free_stack(stack_type x){
-    AP_ERROR_IN_RANGE(x, end(), psize());
-    if (!empty(free_nodes)){
-      _last_jump(free_nodes)=std::move(x);
-    }else{
+    C::in_range(x, end(), psize());
+    _destroy_values(x);
+    counters.free_stack();
+    if (empty(free_nodes)){
       free_nodes = std::move(x);
+    }else if (!empty(x)){
+#ifdef STACK_POOL_WALK_FREE_LIST
+      _last_jump(free_nodes)=std::move(x);
+#else
+      free_segments.push_back(std::move(x));
+#endif
     }
     return end();
   }
 
+  /** Overloaded function that deletes the entire stack of a handle.
+  * Since the handle knows the last node of the stack, the latter is linked in front of free_nodes
+  * in constant time, in both free list modes (the values are destroyed as in \p free_stack(stack_type)).
+  * The function throws if the head or the tail of \p h are larger than \p psize().
+  * @param h handle of the stack to remove
+  * @return the handle of an empty stack
+  */
+  handle free_stack(const handle& h){
+    if (!empty(h)){
+      C::in_range(h.head, end(), psize());
+      _destroy_values(h.head);
+      counters.free_stack();
+      next(h.tail) = free_nodes;
+      free_nodes = h.head;
+    }
+    return new_handle();
+  }
+
+
+
+
+  //___________________Bulk_Operations___________________________________________//
+
+
+  /** Function adding the values in [first, last) to a stack, as if they were pushed one at a time:
+  * the last value of the range becomes the head. \n
+  * The free nodes are used first, relinked in a single pass; the remaining values are appended to the pool
+  * after a single reserve (when the size of the range can be computed, i.e. for forward iterators).
+  * Dereferencing the iterators is assigned or forwarded to the nodes, use \p std::make_move_iterator
+  * to move the values in. \n
+  * Throws if \p head is larger than \p psize(), or through the copy of the values and the growth of the pool:
+  * in that case the nodes already taken are given back to free_nodes and the stack is unchanged.
+  * @tparam It input iterator whose value type is convertible to T
+  * @param first beginning of the range
+  * @param last end of the range
+  * @param head current head of the stack
+  * @return the new head of the stack
+  */
+  template <typename It>
+  stack_type push_range(It first, It last, stack_type head){
+    return _push_range(first, last, head).head;
+  }
+
+  /** Overloaded function adding the values in [first, last) to the stack of a handle, see \p push_range(It, It, stack_type).
+  * @param first beginning of the range
+  * @param last end of the range
+  * @param h current handle of the stack
+  * @return the handle of the stack after adding the values
+  */
+  template <typename It>
+  handle push_range(It first, It last, const handle& h){
+    auto seg = _push_range(first, last, h.head);
+    return handle{seg.head, h.length+seg.length, empty(h.tail) ? seg.tail : h.tail};
+  }
+
+
+  /** Function removing up to k nodes from the top of a stack, moving their values to \p out.
+  * The values are written in popping order, head first; the function stops early if the stack has less than k nodes.
+  * The values are destroyed in the nodes only once all of them have been written, then the removed nodes are linked
+  * in front of free_nodes at once, in constant time. \n
+  * Throws if \p x is larger than \p psize(), or through the move of the values and the output iterator:
+  * in that case no node is removed and the stack is unchanged, but the values already written are left moved from.
+  * @tparam O output iterator accepting values of type T
+  * @param x head of the stack
+  * @param k maximum number of nodes to remove
+  * @param out where the values are moved to
+  * @return the new head of the stack
+  */
+  template <typename O>
+  stack_type pop_n(stack_type x, size_type k, O out){
+    C::in_range(x, end(), psize());
+    if (k==0 || empty(x))
+      return x;
+    const auto head = x;
+    stack_type last;
+    size_type popped = 0;
+    do{
+      *out = std::move(pool.value(x-1));
+      ++out;
+      ++popped;
+      last = x;
+      x = pool.next(x-1);
+    }while (--k > 0 && !empty(x));
+    pool.next(last-1) = end();
+    _destroy_values(head);
+    pool.next(last-1) = free_nodes;
+    free_nodes = head;
+    counters.pop(popped);
+    return x;
+  }
+
+  /** Overloaded function removing k nodes from the top of the stack of a handle, see \p pop_n(stack_type, size_type, O).
+  * Throws if the stack has less than k nodes.
+  * @param h handle of the stack
+  * @param k number of nodes to remove
+  * @param out where the values are moved to
+  * @return the handle of the stack after removing the nodes
+  */
+  template <typename O>
+  handle pop_n(const handle& h, size_type k, O out){
+    AP_ERROR_IN_RANGE(k, size_type(0), h.length);
+    auto x = pop_n(h.head, k, out);
+    return handle{x, h.length-k, k==h.length ? end() : h.tail};
+  }
+
+
+  /** Function moving a whole stack on top of another one, in constant time.
+  * The last node of \p from is linked to the head of \p onto: the result has the nodes of \p from
+  * on top, followed by the nodes of \p onto. No node is copied or moved in memory. \n
+  * The handles must refer to two different stacks; the handles passed are no longer valid after the call.
+  * Throws if the tail of \p from is larger than \p psize().
+  * @param from handle of the stack to move
+  * @param onto handle of the stack receiving it
+  * @return the handle of the joined stack
+  */
+  handle splice(const handle& from, const handle& onto){
+    if (empty(from))
+      return onto;
+    next(from.tail) = onto.head;
+    return handle{from.head, from.length+onto.length, empty(onto) ? from.tail : onto.tail};
+  }
+
+
+
+
+  //___________________Sorting___________________________________________________//
+
+
+  /** Function sorting a stack in place, from the head on, with a bottom-up merge sort.
+  * Only the indexes to the next nodes are relinked: no value is copied or moved, no memory is allocated,
+  * and the sort takes O(n log n) comparisons and O(1) extra space. The sort is stable: equivalent values
+  * keep their order from the head on. The head usually changes, the new one is returned. \n
+  * Throws if \p x is larger than \p psize(). \p comp must not throw: an exception in the middle of a merge leaves the stack broken.
+  * @tparam Compare binary predicate, strict weak ordering on T
+  * @param x head of the stack
+  * @param comp comparison, \p comp(a,b) is true if a goes before (closer to the head than) b
+  * @return the new head of the stack
+  */
+  template <typename Compare = std::less<T>>
+  stack_type sort_stack(stack_type x, Compare comp = Compare{}){
+    C::in_range(x, end(), psize());
+    return _sort(x, comp).head;
+  }
+
+  /** Overloaded function sorting the stack of a handle in place, see \p sort_stack(stack_type, Compare).
+  * @param h handle of the stack
+  * @param comp comparison
+  * @return the handle of the sorted stack
+  */
+  template <typename Compare = std::less<T>>
+  handle sort_stack(const handle& h, Compare comp = Compare{}){
+    C::in_range(h.head, end(), psize());
+    return _sort(h.head, comp);
+  }
+
+  /** Function merging two stacks sorted by \p comp into a single sorted stack, relinking their nodes in O(n1+n2).
+  * On equivalent values the nodes of \p x come first. The two stacks must be different; both heads are
+  * no longer valid after the call. Throws if a head is larger than \p psize().
+  * @tparam Compare binary predicate, strict weak ordering on T
+  * @param x head of the first sorted stack
+  * @param y head of the second sorted stack
+  * @param comp comparison the two stacks are sorted by
+  * @return the head of the merged stack
+  */
+  template <typename Compare = std::less<T>>
+  stack_type merge_sorted(stack_type x, stack_type y, Compare comp = Compare{}){
+    C::in_range(x, end(), psize());
+    C::in_range(y, end(), psize());
+    auto head = end();
+    auto tail = _merge(x, std::numeric_limits<size_type>::max(), y, std::numeric_limits<size_type>::max(), &head, comp);
+    *tail = end();
+    return head;
+  }
+
+  /** Overloaded function merging the sorted stacks of two handles, see \p merge_sorted(stack_type, stack_type, Compare).
+  * @param x handle of the first sorted stack
+  * @param y handle of the second sorted stack
+  * @param comp comparison the two stacks are sorted by
+  * @return the handle of the merged stack
+  */
+  template <typename Compare = std::less<T>>
+  handle merge_sorted(const handle& x, const handle& y, Compare comp = Compare{}){
+    if (empty(x))
+      return y;
+    if (empty(y))
+      return x;
+    const auto head = merge_sorted(x.head, y.head, comp);
+    // the last node is the last one of the stack whose bottom goes after the other's
+    const auto tail = comp(value(y.tail), value(x.tail)) ? x.tail : y.tail;
+    return handle{head, x.length+y.length, tail};
+  }
+
+  /** Function removing the nodes equal to the one right above them, so that each run of equal
+  * values is reduced to its first node (the closest to the head): on a sorted stack, every value is left once.
+  * The values of the removed nodes are destroyed and the nodes are linked in front of free_nodes. The head never changes. \n
+  * Throws if \p x is larger than \p psize().
+  * @tparam Pred binary predicate telling whether two values are equal
+  * @param x head of the stack
+  * @param pred equality
+  * @return the number of removed nodes
+  */
+  template <typename Pred = std::equal_to<T>>
+  size_type unique(stack_type x, Pred pred = Pred{}){
+    C::in_range(x, end(), psize());
+    return _unique(x, pred).length;
+  }
+
+  /** Overloaded function removing the repeated values of the stack of a handle, see \p unique(stack_type, Pred).
+  * @param h handle of the stack
+  * @param pred equality
+  * @return the handle of the stack without the removed nodes
+  */
+  template <typename Pred = std::equal_to<T>>
+  handle unique(const handle& h, Pred pred = Pred{}){
+    C::in_range(h.head, end(), psize());
+    const auto r = _unique(h.head, pred);
+    return handle{h.head, h.length-r.length, r.tail};
+  }
+
+
+
+
+  //___________________Persistence_______________________________________________//
+
+
+  /** Function making a persistent pool durable, available only for layouts backed by a file (\p mapped_layout).
+  * The parked freed stacks are linked to free_nodes (walking each of them once), free_nodes is saved
+  * in the header and the whole mapping is flushed to disk. \n
+  * Throws through the storage if the flush fails.
+  */
+  void sync(){
+    _fold_free_segments();
+    pool.sync(free_nodes);
+  }
+
+
+  /** Function providing a stack head saved in a persistent pool, available only for layouts backed by a file.
+  * Store there the head of a stack you want to find again when the pool is reopened.
+  * @return reference to the root stored in the file
+  */
+  stack_type& root() noexcept{
+    return pool.root();
+  }
+
+
+
+
+  //___________________Compaction________________________________________________//
+
+
+  /** Class \p compaction: state of an incremental compaction of the pool, see \p start_compaction().
+  *
+  * The compaction relocates the nodes so that each stack occupies a contiguous run of the pool,
+  * ordered from the head on (the head at the lowest index, its next right after it, and so on),
+  * with the stacks one after the other in the order of the given heads. Each call to \p step()
+  * moves a bounded number of nodes; the pool is consistent between two steps, and the up-to-date
+  * heads are provided by \p heads(). \n
+  * It works in two phases:
+  * - labeling: the stacks are walked once and the predecessor of each node is recorded
+  *   (for a head, which of the heads points to it)
+  * - placing: the stacks are walked again, and each node that is not in its final slot is swapped
+  *   with the node occupying that slot, fixing the links pointing to both thanks to the predecessors.
+  * Finally the nodes not reachable from the heads are dropped from the end of the pool.
+  *
+  * \b Be \b careful: the heads must include every live stack (the others are lost), and no stack
+  * can be modified until the compaction is over; reading the pool through \p heads() is fine.
+  * A change in the size of the pool is detected and reported by throwing.
+  */
+  class compaction{
+
+    friend class stack_pool;
+
+    enum class phase_t{labeling, placing, finished};
+
+    pool_type* pool;
+    std::vector<stack_type> _heads;
+
+    /** For each node: 0 if it is not reachable from the heads, the predecessor if it's an inner node,
+     * size + 1 + k if it is the head of _heads[k]. */
+    std::vector<size_type> prev;
+
+    size_type size;   // size of the pool when the compaction started
+    size_type placed; // number of nodes already in their final slot
+    size_type k;      // stack being walked
+    stack_type pred;  // last node walked in the current stack, end() at its head
+    stack_type cur;   // node to be walked
+    stack_type free;  // free_nodes when the compaction started, to detect pushes and pops while labeling
+    std::size_t parked; // number of parked freed stacks when the compaction started
+    bool release;
+    phase_t phase;
+
+    compaction(pool_type* p, std::vector<stack_type> h, bool r)
+      : pool{p},
+        _heads{std::move(h)},
+        prev(p->psize(), 0),
+        size{p->psize()},
+        placed{0},
+        k{0},
+        pred{p->end()},
+        cur{_heads.empty() ? p->end() : _heads[0]},
+        free{p->free_nodes},
+        parked{p->free_segments.size()},
+        release{r},
+        phase{phase_t::labeling}{
+      for (auto x : _heads)
+        AP_ERROR_IN_RANGE(x, pool->end(), size);
+    }
+
+    /** Function moving to the head of the next stack, or to the next phase if all stacks were walked. */
+    void next_stack(){
+      ++k;
+      pred = pool->end();
+      if (k < _heads.size()){
+        cur = _heads[k];
+      }else if (phase == phase_t::labeling){
+        // the heads are valid: the free list is dropped, its nodes are overwritten while placing
+        pool->free_nodes = pool->end();
+        pool->free_segments.clear();
+        phase = phase_t::placing;
+        k = 0;
+        cur = _heads.empty() ? pool->end() : _heads[0];
+      }else{
+        finish();
+      }
+    }
+
+    /** Function making the predecessor \p p (a node or a head, see \p prev) point to \p x. */
+    void refer(size_type p, stack_type x) noexcept{
+      if (p > size)
+        _heads[p - size - 1] = x;
+      else
+        pool->pool.next(p - 1) = x;
+    }
+
+    /** Function moving the node c to the slot w, and the node in w (if reachable) to the slot c.
+     * The node in w is never a predecessor of c, since all of them are already placed. */
+    void move(stack_type c, stack_type w){
+      auto& st = pool->pool;
+      const auto pc = prev[c-1];
+      const auto pw = prev[w-1];
+      const auto nc = st.next(c-1);
+      const auto nw = st.next(w-1);
+      using std::swap;
+      if (pw == 0){
+        // w is garbage: c simply takes its place
+        if (st.alive(w-1)){
+          swap(st.value(c-1), st.value(w-1));
+        }else{
+          st.construct(w-1, std::move(st.value(c-1)));
+          st.destroy(c-1);
+        }
+        st.next(w-1) = nc;
+        refer(pc, w);
+        if (!pool->empty(nc))
+          prev[nc-1] = w;
+        prev[w-1] = pc;
+        prev[c-1] = 0;
+      }else if (nc == w){
+        // pc -> c -> w -> nw becomes pc -> w -> c -> nw
+        swap(st.value(c-1), st.value(w-1));
+        st.next(w-1) = c;
+        st.next(c-1) = nw;
+        refer(pc, w);
+        prev[w-1] = pc;
+        prev[c-1] = w;
+        if (!pool->empty(nw))
+          prev[nw-1] = c;
+      }else{
+        swap(st.value(c-1), st.value(w-1));
+        st.next(w-1) = nc;
+        st.next(c-1) = nw;
+        refer(pc, w);
+        refer(pw, c);
+        prev[w-1] = pc;
+        prev[c-1] = pw;
+        if (!pool->empty(nc))
+          prev[nc-1] = w;
+        if (!pool->empty(nw))
+          prev[nw-1] = c;
+      }
+    }
+
+    /** Function dropping the nodes after the last placed one. */
+    void finish(){
+      pool->pool.truncate(placed);
+      if (release)
+        pool->pool.shrink_to_fit();
+      std::vector<size_type>{}.swap(prev);
+      phase = phase_t::finished;
+    }
+
+   public:
+
+    /** Function doing at most \p budget units of work (a node labeled or placed).
+    * Throws if the size of the pool changed since the start of the compaction,
+    * or if a node is reachable from two heads.
+    * @param budget maximum number of nodes handled by this call
+    * @return true if the compaction is over
+    */
+    bool step(size_type budget){
+      if (phase != phase_t::finished)
+        AP_ERROR_EQ(pool->psize(), size) << "The pool has been modified during the compaction\n";
+      if (phase == phase_t::labeling)
+        AP_ERROR(pool->free_nodes == free && pool->free_segments.size() == parked)
+          << "The pool has been modified during the compaction\n";
+      while (budget > 0 && phase != phase_t::finished){
+        if (k == _heads.size() || pool->empty(cur)){
+          next_stack();
+          continue;
+        }
+        if (phase == phase_t::labeling){
+          AP_ERROR(prev[cur-1] == 0) << "Node " << cur << " is reachable from two heads\n";
+          prev[cur-1] = pool->empty(pred) ? size + 1 + k : pred;
+          pred = cur;
+          cur = pool->pool.next(cur-1);
+        }else{
+          const auto w = static_cast<stack_type>(++placed);
+          if (cur != w)
+            move(cur, w);
+          pred = w;
+          cur = pool->pool.next(w-1);
+        }
+        --budget;
+      }
+      return done();
+    }
+
+    /** Function allowing to assess whether the compaction is over. */
+    bool done() const noexcept{
+      return phase == phase_t::finished;
+    }
+
+    /** Function providing the heads of the stacks, up to date with the last step. */
+    const std::vector<stack_type>& heads() const noexcept{
+      return _heads;
+    }
+  };
+
+
+  /** Function starting an incremental compaction of the pool, see \p compaction.
+  * No node is moved until the first call to \p compaction::step(). The free list is emptied once all the heads
+  * have been walked, since the nodes not reachable from them are dropped at the end: if the labeling throws,
+  * the free nodes are still there.
+  * Throws if a head is larger than \p psize().
+  * @param heads heads of all the live stacks
+  * @param release if true, the memory left unused is given back when the compaction is over
+  * @return the state of the compaction
+  */
+  compaction start_compaction(std::vector<stack_type> heads, bool release=false){
+    return compaction{this, std::move(heads), release};
+  }
+
+
+  /** Function compacting the whole pool at once, see \p compaction.
+  * After the call each stack is a contiguous run of nodes ordered from the head on,
+  * the nodes not reachable from the heads are gone and free_nodes is empty.
+  * Takes O(psize()) time and O(psize()) auxiliary memory. \n
+  * Throws if a head is larger than \p psize() or if a node is reachable from two heads.
+  * @param heads heads of all the live stacks
+  * @param release if true, the memory left unused is given back to the system
+  * @return the new heads, in the same order
+  */
+  std::vector<stack_type> compact(std::vector<stack_type> heads, bool release=false){
+    auto c = start_compaction(std::move(heads), release);
+    c.step(std::numeric_limits<size_type>::max());
+    return c.heads();
+  }
+
+
+
+
+  //___________________Traversal_________________________________________________//
+
+
+  /** Function asking the hardware to bring the node x into the cache, without waiting for it.
+  * Nothing happens for \p end(), or if the compiler has no prefetch builtin. The index is not checked.
+  * @param x index of a node
+  */
+  void prefetch(stack_type x) const noexcept{
+#if defined(__GNUC__) || defined(__clang__)
+    if (!empty(x)){
+      __builtin_prefetch(&pool.next(x-1));
+      __builtin_prefetch(&pool.value(x-1));
+    }
+#else
+    static_cast<void>(x);
+#endif
+  }
+
+
+  /** Function calling \p f on the value of each node of a stack, from the head on.
+  * The next node is read and prefetched before \p f is called on the current one, so that the cache miss
+  * of the next node overlaps with the work of \p f. Only the head is checked.
+  * Throws if \p x is larger than \p psize(), or through \p f.
+  * @tparam F callable taking a reference to T
+  * @param x head of the stack
+  * @param f function called on each value
+  */
+  template <typename F>
+  void for_each(stack_type x, F f){
+    _for_each(*this, x, f);
+  }
+  template <typename F>
+  void for_each(stack_type x, F f) const{
+    _for_each(*this, x, f);
+  }
+
+
+  /** Function walking many stacks in lockstep: the stacks whose heads are in [first, last) are walked
+  * W at a time, one node of each in turn, so that up to W cache misses are in flight instead of one. \n
+  * \p f is called as \p f(k, value), where k is the position of the head of the stack in the range:
+  * the values of a stack are visited from its head on, but the values of different stacks are interleaved.
+  * When a stack ends, the next head of the range takes its place. Only the heads are checked. \n
+  * Throws if a head is larger than \p psize(), or through \p f.
+  * @tparam W number of stacks walked at the same time
+  * @tparam It input iterator over the heads
+  * @tparam F callable taking a \p size_type and a reference to T
+  * @param first beginning of the range of heads
+  * @param last end of the range of heads
+  * @param f function called on each value
+  */
+  template <std::size_t W = 8, typename It, typename F>
+  void for_each_lockstep(It first, It last, F f){
+    _for_each_lockstep<W>(*this, first, last, f);
+  }
+  template <std::size_t W = 8, typename It, typename F>
+  void for_each_lockstep(It first, It last, F f) const{
+    _for_each_lockstep<W>(*this, first, last, f);
+  }
+
+
+
+
+  //___________________Statistics________________________________________________//
+
+
+  /** Function providing the counters of the pool, see \p pool_stats.hpp.
+  * With \p no_stats the returned object is empty.
+  * @return constant reference to the counters
+  */
+  const S& stats() const noexcept{
+    return counters;
+  }
+
+  /** Function providing the counters of the pool, e.g. to reset them. */
+  S& stats() noexcept{
+    return counters;
+  }
+
+
+  /** Function computing the histogram of the lengths of some stacks, in power of 2 buckets:
+  * bucket 0 counts the empty stacks, bucket i > 0 the stacks whose length is in [2^(i-1), 2^i). \n
+  * Walks every stack once, throws through \p ssize().
+  * @param heads heads of the stacks
+  * @return the count of stacks in each bucket, up to the last non-empty one
+  */
+  std::vector<size_type> length_histogram(const std::vector<stack_type>& heads) const{
+    std::vector<size_type> buckets;
+    for (auto h : heads){
+      size_type bucket = 0;
+      for (auto n = ssize(h); n > 0; n >>= 1)
+        ++bucket;
+      if (buckets.size() <= bucket)
+        buckets.resize(bucket+1, 0);
+      ++buckets[bucket];
+    }
+    return buckets;
+  }
+
+
+  /** Function writing the state of the pool as a single JSON object, for metrics scrapers:
+  * size, capacity and bytes of the pool, nodes in the free list and parked freed stacks, the counters of the
+  * statistics policy (none with \p no_stats), and the histogram of the lengths of the given stacks
+  * (see \p length_histogram()). \n
+  * Walks the free list and the given stacks.
+  * @param os output stream
+  * @param heads heads of the stacks whose lengths are of interest
+  */
+  void dump_stats(std::ostream& os, const std::vector<stack_type>& heads = {}) const{
+    size_type free_count = 0;
+    const auto count = [this, &free_count](stack_type x){
+      for (; !empty(x); x=pool.next(x-1))
+        ++free_count;
+    };
+    count(free_nodes);
+    for (auto x : free_segments)
+      count(x);
+
+    os << "{\"psize\": " << psize()
+       << ", \"capacity\": " << capacity()
+       << ", \"allocated_bytes\": " << allocated_bytes()
+       << ", \"free_nodes\": " << free_count
+       << ", \"parked_stacks\": " << free_segments.size()
+       << ", \"counters\": {";
+    const char* sep = "";
+    counters.for_each([&os, &sep](const char* name, std::size_t value){
+      os << sep << "\"" << name << "\": " << value;
+      sep = ", ";
+    });
+    os << "}, \"stacks\": " << heads.size() << ", \"length_histogram\": [";
+    sep = "";
+    for (auto b : length_histogram(heads)){
+      os << sep << b;
+      sep = ", ";
+    }
+    os << "]}";
+  }
+
 
 
 
@@ -404,6 +1243,14 @@ class stack_pool{
     return i;
   }
 
+  /** Overloaded function providing the size of the stack of a handle, in constant time.
+  * @param h handle of the stack
+  * @return the size of the stack
+  */
+  size_type ssize(const handle& h) const noexcept{
+    return h.length;
+  }
+
 
   /** Function allowing to reach the value of the \b mth node in the stack.
   * The function allows to access the value of the mth node in the stack, where the
@@ -412,18 +1259,14 @@ class stack_pool{
   * \b Be \b careful, if an intermediate index is passed instead of
   * a head the function considers m=1 the node at the current index. \n
   * - Throws through \p next() or \p value() if x is equal to \p end() or larger than \p psize()
-  * - Throws if the passed m is larger than \p ssize() since this would lead to the previous exception
+  * - Throws if the passed m is larger than \p ssize(), which is detected while walking: the stack is walked only once
   * If m is equal to end() hence 0 in stack_type type, the function returns the value of the first node
   * @param x stack index
   * @param m the hierarchical number of a node, going from the first (1) to the last ( \p ssize(x) )
   * @return reference to the value of the reached node
   */
   value_type& reach(stack_type x, stack_type m) {
-    AP_ERROR_IN_RANGE(m, end(), ssize(x));
-    for (stack_type i=1; i<m; ++i){
-      x=next(x);
-    }
-    return value(x);
+    return value(_reach(x, m));
   }
 
   /** Constant function allowing to reach the value of the \b mth node in the stack.
@@ -433,18 +1276,36 @@ class stack_pool{
   * \b Be \b careful, if an intermediate index is passed instead of
   * a head the function considers m=1 the node at the current index. \n
   * - Throws through \p next() or \p value() if x is equal to \p end() or larger than \p psize()
-  * - Throws if the passed m is larger than \p ssize() since this would lead to the previous exception
+  * - Throws if the passed m is larger than \p ssize(), which is detected while walking: the stack is walked only once
   * If m is equal to end() hence 0 in stack_type type, the function returns the value of the first node
   * @param x stack index
   * @param m the hierarchical number of a node, going from the first (1) to the last ( \p ssize(x) )
   * @return const reference to the value of the reached node
   */
   const value_type& reach(stack_type x, stack_type m) const {
-    AP_ERROR_IN_RANGE(m, end(), ssize(x));
-    for (stack_type i=1; i<m; ++i){
-      x=next(x);
-    }
-    return value(x);
+    return value(_reach(x, m));
+  }
+
+  /** Overloaded function reaching the value of the \b mth node in the stack of a handle.
+  * The range of m is checked in constant time against the length carried by the handle,
+  * the last node is reached without walking, any other node with a single walk of m-1 steps.
+  * - Throws if the stack is empty or if m is larger than the length of the stack
+  * @param h handle of the stack
+  * @param m the hierarchical number of a node, going from the first (1) to the last ( \p ssize(h) )
+  * @return reference to the value of the reached node
+  */
+  value_type& reach(const handle& h, size_type m) {
+    return value(_reach(h, m));
+  }
+
+  /** Constant overloaded function reaching the value of the \b mth node in the stack of a handle.
+  * See \p reach(const handle&, size_type).
+  * @param h handle of the stack
+  * @param m the hierarchical number of a node, going from the first (1) to the last ( \p ssize(h) )
+  * @return const reference to the value of the reached node
+  */
+  const value_type& reach(const handle& h, size_type m) const {
+    return value(_reach(h, m));
   }
 
 
@@ -464,43 +1325,334 @@ class stack_pool{
 
  private:
 
-  /**Function providing the node at a given index.
-   * @param x "stack index" of a node, which is real index + 1
-   * @return the node at the correct index
-   */
-  node_t& node(stack_type x) noexcept {
-    return pool[x-1]; }
-
-  /**Constant function providing the node at a given index.
-   * @param x "stack index" of a node, which is real index + 1
-   * @return the node at the correct index
-   */
-  const node_t& node(stack_type x) const noexcept {
-    return pool[x-1]; }
-
-
-  /**Templated auxiliary function allowing to add 1 node using the public method push.
-   * The function can take both r-values and r-value while being able to correctly
-   * identify and treat them. \n
-   * If free_nodes it's empty the function proceeds to add the node at the end of the pool. \n
-   * If free_nodes it's not empty: the first node of free_nodes becomes the new node and free_nodes
-   * shrinks, while the next element of the already gone first element becomes its new head.
+  /**Templated auxiliary function allowing to add 1 node using the public methods push and emplace.
+   * The value is constructed in place from the forwarded arguments, so that l-values are copied
+   * and r-values moved exactly once. \n
+   * If free_nodes it's empty, the last parked freed stack (if any) becomes free_nodes. \n
+   * If free_nodes it's still empty the function proceeds to add the node at the end of the pool. \n
+   * If free_nodes it's not empty: the value is constructed in the first node of free_nodes, which becomes the new node,
+   * while the next element of the already gone first element becomes the new head of free_nodes.
    * See \p supplementary_materials. \n
-   * The function throws through push_back and through _new_first (in case \n head is equal to \p end() or larger than \p psize())
-   * @param V deduced from the arguments passed to the function
-   * @param val universal reference to the value of the new node
+   * The function throws if \p head is larger than \p psize(), through \p emplace_back() and through the constructor of T:
+   * in all cases the pool is left unchanged.
    * @param head current head of the stack, index that will become the next of the new node
+   * @param args arguments forwarded to the constructor of T
    * @return the new head of the stack hence index of the new node
    */
-  template <typename V>
-  stack_type _push(V&& val, stack_type head) {
+  template <typename... Args>
+  stack_type _emplace(stack_type head, Args&&... args) {
+    C::in_range(head, end(), psize());
+    if (empty(free_nodes) && !free_segments.empty()){
+      free_nodes = free_segments.back();
+      free_segments.pop_back();
+    }
     if (empty(free_nodes)){
-      pool.push_back(node_t{std::forward<V>(val), head});
+      const auto cap = pool.capacity();
+      pool.emplace_back(head, std::forward<Args>(args)...);
+      counters.push(false);
+      counters.grow(cap, pool.capacity());
       return static_cast<stack_type>(pool.size());
     }
-    _new_first(head, free_nodes);
-    value(head)=std::forward<V>(val);
-    return static_cast<stack_type>(head);
+    const auto x = free_nodes;
+    pool.construct(x-1, std::forward<Args>(args)...);
+    free_nodes = pool.next(x-1);
+    pool.next(x-1) = head;
+    counters.push(true);
+    return x;
+  }
+
+
+  /**Templated auxiliary function adding 1 node to the stack of a handle.
+   * The new node becomes the head, and also the tail if the stack was empty.
+   * Throws through \p _emplace().
+   * @param h current handle of the stack
+   * @param args arguments forwarded to the constructor of T
+   * @return the updated handle
+   */
+  template <typename... Args>
+  handle _emplace_handle(const handle& h, Args&&... args) {
+    auto x = _emplace(h.head, std::forward<Args>(args)...);
+    return handle{x, h.length+1, empty(h.tail) ? x : h.tail};
+  }
+
+
+  /**Templated auxiliary function adding the values of a range on top of a stack, see \p push_range().
+   * Takes the free nodes first, then appends to the pool after reserving room for the rest of the range.
+   * If something throws, the nodes already taken are given back to free_nodes.
+   * @param first beginning of the range
+   * @param last end of the range
+   * @param head current head of the stack
+   * @return the handle of the added segment, whose tail points to \p head (its head is \p head if the range is empty)
+   */
+  template <typename It>
+  handle _push_range(It first, It last, stack_type head){
+    C::in_range(head, end(), psize());
+    handle seg{head, 0, end()};
+    const auto n = _distance(first, last, typename std::iterator_traits<It>::iterator_category{});
+    try{
+      for (; first!=last; ++first){
+        if (empty(free_nodes) && !free_segments.empty()){
+          free_nodes = free_segments.back();
+          free_segments.pop_back();
+        }
+        if (empty(free_nodes))
+          break;
+        const auto x = free_nodes;
+        pool.construct(x-1, *first);
+        free_nodes = pool.next(x-1);
+        pool.next(x-1) = seg.head;
+        seg.head = x;
+        if (seg.length++ == 0)
+          seg.tail = x;
+        counters.push(true);
+      }
+      if (first!=last && n > seg.length)
+        reserve(psize()+n-seg.length);
+      for (; first!=last; ++first){
+        const auto cap = pool.capacity();
+        pool.emplace_back(seg.head, *first);
+        counters.push(false);
+        counters.grow(cap, pool.capacity());
+        seg.head = static_cast<stack_type>(pool.size());
+        if (seg.length++ == 0)
+          seg.tail = seg.head;
+      }
+    }catch(...){
+      if (seg.length > 0){
+        pool.next(seg.tail-1) = end();
+        _destroy_values(seg.head);
+        pool.next(seg.tail-1) = free_nodes;
+        free_nodes = seg.head;
+      }
+      throw;
+    }
+    return seg;
+  }
+
+
+  /**Auxiliary function providing the length of a range of forward iterators, used to reserve the pool once.*/
+  template <typename It>
+  static size_type _distance(It first, It last, std::forward_iterator_tag){
+    return static_cast<size_type>(std::distance(first, last));
+  }
+
+  /**Auxiliary function for input iterators, whose range can be walked only once: nothing is reserved in advance.*/
+  template <typename It>
+  static size_type _distance(It, It, std::input_iterator_tag) noexcept{
+    return 0;
+  }
+
+
+  /**Auxiliary function walking a stack one node ahead, shared by the const and non-const \p for_each().
+   * @param self the pool, const or not
+   * @param x head of the stack
+   * @param f function called on each value
+   */
+  template <typename P, typename F>
+  static void _for_each(P& self, stack_type x, F& f){
+    C::in_range(x, self.end(), self.psize());
+    while (!self.empty(x)){
+      const auto n = self.pool.next(x-1);
+      self.prefetch(n);
+      f(self.pool.value(x-1));
+      x = n;
+    }
+  }
+
+  /**Auxiliary function walking the stacks of a range of heads W at a time, see \p for_each_lockstep().
+   * Each slot holds the current node of a stack and the position of its head in the range:
+   * the node of a slot was prefetched when the slot was last visited, W steps before.
+   * @param self the pool, const or not
+   * @param first beginning of the range of heads
+   * @param last end of the range of heads
+   * @param f function called on each value
+   */
+  template <std::size_t W, typename P, typename It, typename F>
+  static void _for_each_lockstep(P& self, It first, It last, F& f){
+    static_assert(W > 0, "at least a stack at a time");
+    stack_type cur[W];
+    size_type id[W];
+    size_type k = 0;
+    // fills slot s with the next non empty stack of the range, if any
+    auto refill = [&](std::size_t s){
+      for (; first != last; ++first, ++k){
+        const stack_type h = *first;
+        C::in_range(h, self.end(), self.psize());
+        if (!self.empty(h)){
+          self.prefetch(h);
+          cur[s] = h;
+          id[s] = k++;
+          ++first;
+          return true;
+        }
+      }
+      return false;
+    };
+    std::size_t active = 0;
+    while (active < W && refill(active))
+      ++active;
+    while (active > 0){
+      for (std::size_t s = 0; s < active; ){
+        const auto x = cur[s];
+        const auto n = self.pool.next(x-1);
+        self.prefetch(n);
+        f(id[s], self.pool.value(x-1));
+        if (!self.empty(n)){
+          cur[s++] = n;
+        }else if (!refill(s)){
+          --active;
+          cur[s] = cur[active];
+          id[s] = id[active];
+        }else{
+          ++s;
+        }
+      }
+    }
+  }
+
+
+  /**Auxiliary function merging the first \p nx nodes from \p x with the first \p ny nodes from \p y,
+   * stopping earlier at the end of a stack. The merged nodes are linked one after the other starting from \p *tail,
+   * taking the node of \p x on equivalent values; the next of the last merged node is left to the caller.
+   * \p x and \p y are moved past the merged nodes.
+   * @param x first run, updated
+   * @param nx maximum length of the first run
+   * @param y second run, updated
+   * @param ny maximum length of the second run
+   * @param tail where the first merged node is linked
+   * @param comp comparison
+   * @return where the node following the merged ones has to be linked
+   */
+  template <typename Compare>
+  stack_type* _merge(stack_type& x, size_type nx, stack_type& y, size_type ny, stack_type* tail, Compare& comp){
+    while (nx > 0 && !empty(x) && ny > 0 && !empty(y)){
+      stack_type e;
+      if (comp(pool.value(y-1), pool.value(x-1))){
+        e = y;
+        y = pool.next(y-1);
+        --ny;
+      }else{
+        e = x;
+        x = pool.next(x-1);
+        --nx;
+      }
+      *tail = e;
+      tail = &pool.next(e-1);
+    }
+    for (; nx > 0 && !empty(x); --nx, x = pool.next(x-1)){
+      *tail = x;
+      tail = &pool.next(x-1);
+    }
+    for (; ny > 0 && !empty(y); --ny, y = pool.next(y-1)){
+      *tail = y;
+      tail = &pool.next(y-1);
+    }
+    return tail;
+  }
+
+  /**Auxiliary function sorting a stack with a bottom-up merge sort.
+   * The nodes are taken from the head one at a time and carried through an array of sorted runs,
+   * where run k is empty or holds 2^k nodes, like a binary counter: a new node is merged with run 0,
+   * the result with run 1 and so on up to the first empty run. At the end the runs are merged from the shortest.
+   * Each node is merged log2(n) times as in a merge sort by passes, but the merges touch nodes that were just
+   * touched, instead of walking the whole stack at each pass. The array has a run per bit of \p size_type.
+   * Stability: the nodes of the longer runs are all above (closer to the head than) the nodes of the shorter ones,
+   * which are hence always passed first to \p _merge().
+   * @param x head of the stack
+   * @param comp comparison
+   * @return the handle of the sorted stack
+   */
+  template <typename Compare>
+  handle _sort(stack_type x, Compare& comp){
+    constexpr auto max = std::numeric_limits<size_type>::max();
+    stack_type runs[std::numeric_limits<size_type>::digits]{};
+    handle h{end(), 0, end()};
+    while (!empty(x)){
+      auto run = x;
+      x = pool.next(x-1);
+      pool.next(run-1) = end();
+      ++h.length;
+      std::size_t k = 0;
+      for (; !empty(runs[k]); ++k){
+        auto head = end();
+        *_merge(runs[k], max, run, max, &head, comp) = end();
+        runs[k] = end();
+        run = head;
+      }
+      runs[k] = run;
+    }
+    for (auto run : runs){
+      if (empty(run))
+        continue;
+      auto head = end();
+      *_merge(run, max, h.head, max, &head, comp) = end();
+      h.head = head;
+    }
+    // one more walk finds the last node, negligible next to the sort
+    h.tail = h.head;
+    while (!empty(h.tail) && !empty(pool.next(h.tail-1)))
+      h.tail = pool.next(h.tail-1);
+    return h;
+  }
+
+  /**Auxiliary function removing the nodes equal to the one above them, see \p unique().
+   * @param x head of the stack
+   * @param pred equality
+   * @return a handle whose length is the number of removed nodes, and whose tail is the last node left
+   */
+  template <typename Pred>
+  handle _unique(stack_type x, Pred& pred){
+    handle r{x, 0, x};
+    if (empty(x))
+      return r;
+    for (auto y = pool.next(x-1); !empty(y); y = pool.next(x-1)){
+      if (pred(pool.value(x-1), pool.value(y-1))){
+        pool.next(x-1) = pool.next(y-1);
+        pool.destroy(y-1);
+        pool.next(y-1) = free_nodes;
+        free_nodes = y;
+        ++r.length;
+      }else{
+        x = y;
+      }
+    }
+    r.tail = x;
+    counters.pop(r.length);
+    return r;
+  }
+
+
+  /**Auxiliary function providing the index of the \b mth node of a stack, with a single walk.
+   * Throws if m is larger than the size of the stack.
+   * @param x stack index
+   * @param m the hierarchical number of a node
+   * @return index of the reached node
+   */
+  stack_type _reach(stack_type x, stack_type m) const {
+    AP_ERROR(!empty(x)) << "Cannot reach a node of an empty stack\n";
+    for (stack_type i=1; i<m; ++i){
+      x=next(x);
+      AP_ERROR(!empty(x)) << "Out of range: " << m << " is larger than the size of the stack\n";
+    }
+    return x;
+  }
+
+
+  /**Auxiliary function providing the index of the \b mth node of the stack of a handle.
+   * Throws if m is larger than the length of the stack.
+   * @param h handle of the stack
+   * @param m the hierarchical number of a node
+   * @return index of the reached node
+   */
+  stack_type _reach(const handle& h, size_type m) const {
+    AP_ERROR_IN_RANGE(m, size_type(0), h.length);
+    AP_ERROR(!empty(h)) << "Cannot reach a node of an empty stack\n";
+    if (m==h.length)
+      return h.tail;
+    auto x = h.head;
+    for (size_type i=1; i<m; ++i)
+      x=next(x);
+    return x;
   }
 
 
@@ -513,14 +1665,14 @@ class stack_pool{
    * See \p supplementary_materials \n
    * The function throws through \p next() if s2 is equal to \p end() or larger than \p psize() since there are no nodes there. \n
    * Throws "de novo" if s1 is larger than \p psize(); no problem if s1 is equal to \p end() \n
-   * When the function is accessed through _push, we can be sure that at least the first condition is respected since it's accessed if !(empty(free_nodes))
+   * When the function is accessed through pop, s1 is free_nodes, which is always in range, so only s2 is checked
    * @tparam V deduced from the arguments passed to the function
    * @param val universal reference to the value of the new node
    * @param head index that will become the next of the new node
    * @return the new head of the stack hence index of the new node
    */
   void _new_first(stack_type& s1, stack_type& s2){
-    AP_ERROR_IN_RANGE(s1, end(), psize());
+    C::in_range(s1, end(), psize());
     auto tmp=s2;
     s2=next(s2);
     next(tmp)= s1;
@@ -528,6 +1680,44 @@ class stack_pool{
   }
 
 
+  /**Auxiliary function destroying the values of a stack, walking it only if T is not trivially destructible.
+   * The nodes are not unlinked.
+   * @param x head of the stack
+   */
+  void _destroy_values(stack_type x) noexcept{
+    if (std::is_trivially_destructible<T>::value)
+      return;
+    for (; !empty(x); x=pool.next(x-1))
+      pool.destroy(x-1);
+  }
+
+
+  /**Auxiliary function linking every parked freed stack to free_nodes.
+   * Each segment is walked up to its last node, whose next becomes free_nodes.
+   */
+  void _fold_free_segments() noexcept{
+    for (auto x : free_segments){
+      _last_jump(x) = free_nodes;
+      free_nodes = x;
+    }
+    free_segments.clear();
+  }
+
+
+  /**Auxiliary function saving the free list in the header of a persistent layout when the pool is destroyed.
+   * Selected only if the storage has a \p store() member, i.e. it is backed by a file.
+   */
+  template <typename Storage>
+  auto _close(Storage& s, int) noexcept -> decltype(s.store(free_nodes), void()){
+    _fold_free_segments();
+    s.store(free_nodes);
+  }
+
+  /**Auxiliary function doing nothing when the pool is destroyed, for layouts that are not persistent.*/
+  template <typename Storage>
+  void _close(Storage&, long) noexcept{}
+
+
   /**Auxiliary function allowing to easily reach the \p next element of the last node of the passed stack.
    * See \p supplementary_materials \n
    * The function does not throw since it's only passed the head of non-empty free_nodes:
@@ -539,9 +1729,12 @@ class stack_pool{
    * @return reference to the last node's \p next() element, always equal to \p end()
    */
   stack_type& _last_jump(stack_type x) noexcept{
+      size_type walked = 0;
       while (!empty(next(x))) {
         x=next(x);     //hope in NRVO
+        ++walked;
       }
+      counters.walk(walked);
       return next(x);
     }
 
@@ -1,7 +1,17 @@
 #include "catch.hpp"
 
 #include "stack_pool.hpp"
+#include "mapped_layout.hpp"
+#include "instrumented.hpp"
 #include <algorithm> // max_element, min_element
+#include <cstdio> // remove
+#include <functional> // greater
+#include <iterator> // back_inserter
+#include <memory> // shared_ptr
+#include <sstream>
+#include <stdexcept> // runtime_error
+#include <string>
+#include <vector>
 
 
 // TEST THAT THE INTERFACE IS NOT BROKEN
@@ -174,3 +184,847 @@ SCENARIO("using iterators"){
   }
 
 }
+
+SCENARIO("freeing many stacks"){
+  GIVEN("a pool with some stacks of different length"){
+    stack_pool<int, uint16_t> pool{};
+    std::vector<uint16_t> heads;
+    for (int s=1; s<=10; ++s){
+      auto l = pool.new_stack();
+      for (int i=0; i<s; ++i)
+        l = pool.push(i, l);
+      heads.push_back(l);
+    }
+    auto size = pool.psize();
+    REQUIRE(size == 55);
+
+    WHEN("we free all of them"){
+      for (auto& h : heads)
+        h = pool.free_stack(h);
+
+      THEN("every freed node is reused before the pool grows"){
+        auto l = pool.new_stack();
+        for (int i=0; i<55; ++i)
+          l = pool.push(i, l);
+        REQUIRE(pool.psize() == size);
+        REQUIRE(pool.ssize(l) == 55);
+
+        l = pool.push(55, l);
+        REQUIRE(pool.psize() == size + 1);
+      }
+    }
+  }
+}
+
+SCENARIO("using handles that carry length and tail"){
+  GIVEN("a stack built through a handle"){
+    stack_pool<int, uint16_t> pool{};
+    auto h = pool.new_handle();
+    REQUIRE(pool.empty(h));
+    REQUIRE(pool.ssize(h) == 0);
+
+    for (int i=1; i<=5; ++i)
+      h = pool.push(i, h);
+
+    THEN("size and tail are known without walking"){
+      REQUIRE(pool.ssize(h) == 5);
+      REQUIRE(pool.value(h.tail) == 1);
+      REQUIRE(pool.reach(h, 1) == 5);
+      REQUIRE(pool.reach(h, 3) == 3);
+      REQUIRE(pool.reach(h, 5) == 1);
+      REQUIRE_THROWS(pool.reach(h, 6));
+    }
+
+    THEN("the handle agrees with the plain index interface"){
+      REQUIRE(pool.ssize(h.head) == pool.ssize(h));
+      REQUIRE(pool.reach(h.head, 4) == pool.reach(h, 4));
+      REQUIRE_THROWS(pool.reach(h.head, 6));
+      auto h2 = pool.make_handle(h.head);
+      REQUIRE(h2.length == h.length);
+      REQUIRE(h2.tail == h.tail);
+    }
+
+    WHEN("we pop every node"){
+      while (!pool.empty(h))
+        h = pool.pop(h);
+      REQUIRE(h.length == 0);
+      REQUIRE(h.tail == pool.end());
+      REQUIRE_THROWS(pool.pop(h));
+    }
+
+    WHEN("we free the stack"){
+      auto l = pool.new_stack();
+      l = pool.push(42, l);
+      h = pool.free_stack(h);
+      REQUIRE(pool.empty(h));
+
+      THEN("its nodes are reused"){
+        auto size = pool.psize();
+        for (int i=0; i<5; ++i)
+          l = pool.push(i, l);
+        REQUIRE(pool.psize() == size);
+        REQUIRE(pool.ssize(l) == 6);
+      }
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("every layout behaves the same", "[layout]", aos_layout, soa_layout, segmented_layout<2>){
+  stack_pool<int, uint16_t, TestType> pool{4};
+  REQUIRE(pool.capacity() >= 4);
+
+  auto l1 = pool.new_stack();
+  l1 = pool.push(3, l1);
+  l1 = pool.push(1, l1);
+  l1 = pool.push(4, l1);
+  auto l2 = pool.new_stack();
+  l2 = pool.push(1, l2);
+  l2 = pool.push(5, l2);
+
+  REQUIRE(pool.value(l1) == 4);
+  REQUIRE(pool.ssize(l1) == 3);
+  REQUIRE(pool.reach(l1, 3) == 3);
+  REQUIRE(*std::max_element(pool.begin(l2), pool.end(l2)) == 5);
+
+  l1 = pool.pop(l1);
+  l2 = pool.push(9, l2);
+  REQUIRE(l2 == 3);
+  REQUIRE(pool.psize() == 5);
+
+  l1 = pool.free_stack(l1);
+  auto h = pool.new_handle();
+  h = pool.push(2, h);
+  h = pool.push(6, h);
+  REQUIRE(pool.psize() == 5);
+  REQUIRE(pool.reach(h, 2) == 2);
+}
+
+TEMPLATE_TEST_CASE("every checking policy behaves the same on valid indexes", "[checks]", checked, debug_assert, unchecked){
+  stack_pool<int, uint16_t, aos_layout, TestType> pool{};
+  auto l = pool.new_stack();
+  for (int i=0; i<10; ++i)
+    l = pool.push(i, l);
+  l = pool.pop(l);
+
+  REQUIRE(*std::max_element(pool.cbegin(l), pool.cend(l)) == 8);
+  REQUIRE(pool.ssize(l) == 9);
+  REQUIRE(pool.value(pool.next(l)) == 7);
+  l = pool.free_stack(l);
+  REQUIRE(pool.empty(l));
+}
+
+SCENARIO("checking the indexes"){
+  GIVEN("a checked pool"){
+    stack_pool<int, uint16_t> pool{};
+    auto l = pool.push(1, pool.new_stack());
+
+    THEN("end() and indexes past the pool are rejected"){
+      REQUIRE_THROWS(pool.value(pool.end()));
+      REQUIRE_THROWS(pool.next(pool.end()));
+      REQUIRE_THROWS(pool.value(l+1));
+      REQUIRE_THROWS(pool.pop(pool.end()));
+      REQUIRE_THROWS(pool.cbegin(l+1));
+      REQUIRE_NOTHROW(pool.cbegin(pool.end()));
+    }
+  }
+
+#ifndef NDEBUG
+  GIVEN("a pool checked in debug builds only"){
+    stack_pool<int, uint16_t, aos_layout, debug_assert> pool{};
+    THEN("it throws as well, this is a debug build"){
+      REQUIRE_THROWS(pool.value(pool.end()));
+    }
+  }
+#endif
+}
+
+/** Stateful allocator counting the bytes it holds, to check that the pool allocates through it. */
+template <typename T>
+struct counting_allocator{
+  using value_type = T;
+  std::size_t* bytes;
+
+  explicit counting_allocator(std::size_t* b) noexcept : bytes{b} {}
+  template <typename U>
+  counting_allocator(const counting_allocator<U>& other) noexcept : bytes{other.bytes} {}
+
+  T* allocate(std::size_t n){
+    *bytes += n * sizeof(T);
+    return std::allocator<T>{}.allocate(n);
+  }
+  void deallocate(T* p, std::size_t n) noexcept{
+    *bytes -= n * sizeof(T);
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  friend bool operator==(const counting_allocator& x, const counting_allocator& y){ return x.bytes == y.bytes; }
+  friend bool operator!=(const counting_allocator& x, const counting_allocator& y){ return !(x == y); }
+};
+
+TEMPLATE_TEST_CASE("allocating the nodes through an allocator", "[layout]", aos_layout, soa_layout, segmented_layout<2>){
+  using alloc_t = counting_allocator<std::string>;
+  using pool_t = stack_pool<std::string, uint16_t, TestType, checked, alloc_t>;
+  std::size_t bytes = 0;
+
+  GIVEN("a pool built on a counting allocator"){
+    {
+      pool_t pool{alloc_t{&bytes}};
+      REQUIRE(pool.get_allocator().bytes == &bytes);
+      auto l = pool.new_stack();
+      auto m = pool.new_stack();
+      for (int i=0; i<100; ++i){
+        l = pool.push(std::to_string(i), l);
+        m = pool.emplace(m, 3, 'x');
+      }
+      l = pool.free_stack(l);
+      m = pool.free_stack(pool.pop(m));
+
+      THEN("all the nodes come from it"){
+        REQUIRE(pool.allocated_bytes() > 0);
+        REQUIRE(bytes >= pool.allocated_bytes());
+      }
+
+      THEN("copies allocate from it too"){
+        const auto before = bytes;
+        pool_t copy{pool};
+        REQUIRE(bytes > before);
+        REQUIRE(copy.get_allocator() == pool.get_allocator());
+      }
+    }
+
+    THEN("everything is given back when the pool dies"){
+      REQUIRE(bytes == 0);
+    }
+  }
+}
+
+SCENARIO("counting what the pool does"){
+  GIVEN("a pool with statistics"){
+    stack_pool<int, uint16_t, aos_layout, checked, std::allocator<int>, pool_stats> pool{};
+    std::vector<uint16_t> heads(4, pool.new_stack());
+    for (int i=0; i<20; ++i)
+      heads[0] = pool.push(i, heads[0]);
+    for (int i=0; i<3; ++i)
+      heads[1] = pool.push(i, heads[1]);
+    heads[2] = pool.push(0, heads[2]);
+
+    WHEN("nodes are popped, freed and pushed again"){
+      heads[0] = pool.pop(heads[0]);
+      std::vector<int> out;
+      heads[0] = pool.pop_n(heads[0], 4, std::back_inserter(out));
+      auto junk = pool.free_stack(pool.push(0, pool.new_stack()));
+      for (int i=0; i<10; ++i)
+        heads[3] = pool.push(i, heads[3]);
+
+      THEN("the counters tell the free list hits from the misses"){
+        const auto& st = pool.stats();
+        REQUIRE(st.pushes == 35);
+        REQUIRE(st.free_hits == 6);
+        REQUIRE(st.free_misses == 29);
+        REQUIRE(st.pops == 5);
+        REQUIRE(st.free_stacks == 1);
+        REQUIRE(st.reallocations > 0);
+        REQUIRE(st.hit_rate() == Approx(6./35));
+        REQUIRE(pool.empty(junk));
+      }
+
+      THEN("the lengths of the stacks are summarized in a histogram"){
+        // lengths 15, 3, 1, 10
+        REQUIRE(pool.length_histogram(heads) == std::vector<std::size_t>{0, 1, 1, 0, 2});
+      }
+
+      THEN("everything can be dumped as JSON"){
+        std::ostringstream os;
+        pool.dump_stats(os, heads);
+        const auto json = os.str();
+        REQUIRE(json.front() == '{');
+        REQUIRE(json.back() == '}');
+        REQUIRE(json.find("\"psize\": 29") != std::string::npos);
+        REQUIRE(json.find("\"free_nodes\": 0") != std::string::npos);
+        REQUIRE(json.find("\"free_hits\": 6") != std::string::npos);
+        REQUIRE(json.find("\"length_histogram\": [0, 1, 1, 0, 2]") != std::string::npos);
+      }
+    }
+  }
+
+  GIVEN("a pool without statistics"){
+    stack_pool<int, uint16_t> pool{};
+    auto l = pool.push(1, pool.new_stack());
+    std::ostringstream os;
+    pool.dump_stats(os, {l});
+    THEN("the dump has no counters"){
+      REQUIRE(os.str().find("\"counters\": {}") != std::string::npos);
+    }
+  }
+}
+
+SCENARIO("growing a segmented pool"){
+  GIVEN("a pool made of blocks of 4 nodes"){
+    stack_pool<int, uint16_t, segmented_layout<2>> pool{5};
+    REQUIRE(pool.capacity() == 8);
+
+    auto l = pool.new_stack();
+    l = pool.push(1, l);
+    int& first = pool.value(l);
+
+    WHEN("the pool grows well beyond its capacity"){
+      for (int i=2; i<=100; ++i)
+        l = pool.push(i, l);
+
+      THEN("nodes are never moved"){
+        REQUIRE(&first == &pool.reach(l, 100));
+        REQUIRE(first == 1);
+        REQUIRE(pool.capacity() == 100);
+      }
+
+      THEN("copies are deep"){
+        auto copy = pool;
+        copy.value(l) = -1;
+        REQUIRE(pool.value(l) == 100);
+        REQUIRE(copy.ssize(l) == 100);
+      }
+    }
+  }
+}
+
+SCENARIO("constructing values in place"){
+  using counted = instrumented<int>;
+  using ops = instrumented_base;
+
+  GIVEN("a pool of instrumented values"){
+    stack_pool<counted, uint16_t> pool{8};
+    auto l = pool.new_stack();
+    ops::initialize(0);
+
+    WHEN("values are emplaced, copied and moved in"){
+      l = pool.emplace(l, 1);
+      REQUIRE(ops::counts[ops::move_ctor] == 0);
+      REQUIRE(ops::counts[ops::copy_ctor] == 0);
+
+      const counted two{2};
+      l = pool.push(two, l);
+      REQUIRE(ops::counts[ops::copy_ctor] == 1);
+
+      l = pool.push(counted{3}, l);
+      REQUIRE(ops::counts[ops::move_ctor] == 1);
+      REQUIRE(ops::counts[ops::dtor] == 1); // the temporary
+
+      THEN("no assignment nor default construction ever happens"){
+        REQUIRE(ops::counts[ops::copy_assign] == 0);
+        REQUIRE(ops::counts[ops::move_assign] == 0);
+        REQUIRE(ops::counts[ops::default_ctor] == 0);
+        REQUIRE(int(pool.value(l)) == 3);
+      }
+
+      AND_WHEN("they are popped and the free nodes reused"){
+        ops::initialize(0);
+        l = pool.pop(l);
+        REQUIRE(ops::counts[ops::dtor] == 1);
+        l = pool.free_stack(l);
+        REQUIRE(ops::counts[ops::dtor] == 3);
+
+        l = pool.emplace(l, 4);
+        l = pool.emplace(pool.make_handle(l), 5).head;
+
+        THEN("the values are built in the free nodes, without any copy or move"){
+          REQUIRE(pool.psize() == 3);
+          REQUIRE(ops::counts[ops::move_ctor] == 0);
+          REQUIRE(ops::counts[ops::copy_ctor] == 0);
+          REQUIRE(ops::counts[ops::move_assign] == 0);
+          REQUIRE(ops::counts[ops::copy_assign] == 0);
+          REQUIRE(int(pool.value(l)) == 5);
+        }
+      }
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("popped values are destroyed in every layout", "[layout]", aos_layout, soa_layout, segmented_layout<2>){
+  GIVEN("a pool holding shared resources"){
+    auto resource = std::make_shared<int>(42);
+    stack_pool<std::shared_ptr<int>, uint16_t, TestType> pool{};
+    auto l = pool.new_stack();
+    for (int i=0; i<4; ++i)
+      l = pool.push(resource, l);
+    REQUIRE(resource.use_count() == 5);
+
+    WHEN("the values are popped or freed"){
+      l = pool.pop(l);
+      REQUIRE(resource.use_count() == 4);
+      std::vector<std::shared_ptr<int>> out;
+      l = pool.pop_n(l, 1, std::back_inserter(out));
+      REQUIRE(resource.use_count() == 4);
+      out.clear();
+      l = pool.free_stack(l);
+
+      THEN("they release the resource right away"){
+        REQUIRE(resource.use_count() == 1);
+      }
+
+      THEN("copies of the pool do not resurrect them"){
+        auto copy = pool;
+        l = copy.emplace(l, resource);
+        REQUIRE(resource.use_count() == 2);
+        REQUIRE(copy.psize() == 4);
+      }
+    }
+  }
+}
+
+// output iterator throwing at its n-th write
+template <typename T>
+struct throwing_writer{
+  std::vector<T>* out;
+  int left;
+  throwing_writer& operator*(){ return *this; }
+  throwing_writer& operator++(){ return *this; }
+  throwing_writer& operator=(T&& v){
+    if (left-- == 0)
+      throw std::runtime_error{"output full"};
+    out->push_back(std::move(v));
+    return *this;
+  }
+};
+
+SCENARIO("moving many values at once"){
+  GIVEN("a pool with some free nodes"){
+    stack_pool<int, uint16_t> pool{};
+    auto junk = pool.new_stack();
+    for (int i=0; i<3; ++i)
+      junk = pool.push(-1, junk);
+    junk = pool.free_stack(junk);
+    auto l = pool.push(0, pool.new_stack());
+    const std::vector<int> values{1, 2, 3, 4, 5, 6, 7, 8};
+
+    WHEN("a range is pushed"){
+      l = pool.push_range(values.begin(), values.end(), l);
+
+      THEN("it is the same as pushing one value at a time, and free nodes come first"){
+        REQUIRE(std::vector<int>(pool.cbegin(l), pool.cend(l)) == std::vector<int>{8, 7, 6, 5, 4, 3, 2, 1, 0});
+        REQUIRE(pool.psize() == 9);
+      }
+
+      AND_WHEN("some values are popped at once"){
+        std::vector<int> out;
+        l = pool.pop_n(l, 3, std::back_inserter(out));
+
+        THEN("they come out head first and their nodes are reused"){
+          REQUIRE(out == std::vector<int>{8, 7, 6});
+          REQUIRE(pool.value(l) == 5);
+          auto m = pool.push_range(values.begin(), values.begin()+4, pool.new_stack());
+          REQUIRE(pool.ssize(m) == 4);
+          REQUIRE(pool.psize() == 10);
+        }
+
+        THEN("popping more than the stack has stops at its end"){
+          l = pool.pop_n(l, 100, std::back_inserter(out));
+          REQUIRE(pool.empty(l));
+          REQUIRE(out.size() == 9);
+          REQUIRE(out.back() == 0);
+        }
+      }
+    }
+
+    WHEN("handles are used"){
+      auto h = pool.push_range(values.begin(), values.end(), pool.new_handle());
+      auto g = pool.push_range(values.begin(), values.begin()+2, pool.make_handle(l));
+      REQUIRE(h.length == 8);
+      REQUIRE(pool.value(h.tail) == 1);
+      REQUIRE(g.length == 3);
+      REQUIRE(pool.value(g.tail) == 0);
+
+      THEN("splice joins two stacks in constant time"){
+        auto j = pool.splice(g, h);
+        REQUIRE(j.length == 11);
+        REQUIRE(j.tail == h.tail);
+        REQUIRE(std::vector<int>(pool.cbegin(j.head), pool.cend(j.head)) == std::vector<int>{2, 1, 0, 8, 7, 6, 5, 4, 3, 2, 1});
+        REQUIRE(pool.splice(pool.new_handle(), j).head == j.head);
+        REQUIRE(pool.splice(j, pool.new_handle()).tail == j.tail);
+      }
+
+      THEN("pop_n on a handle throws if the stack is too short"){
+        std::vector<int> out;
+        REQUIRE_THROWS(pool.pop_n(g, 4, std::back_inserter(out)));
+        g = pool.pop_n(g, 3, std::back_inserter(out));
+        REQUIRE(pool.empty(g));
+        REQUIRE(pool.empty(g.tail));
+      }
+    }
+  }
+
+  GIVEN("a stack of instrumented values and an output throwing at its third write"){
+    using counted = instrumented<int>;
+    using ops = instrumented_base;
+    stack_pool<counted, uint16_t> pool{};
+    auto l = pool.new_stack();
+    for (int i=0; i<6; ++i)
+      l = pool.emplace(l, i);
+    std::vector<counted> out;
+    out.reserve(8);
+    ops::initialize(0);
+    REQUIRE_THROWS_AS(pool.pop_n(l, 4, throwing_writer<counted>{&out, 2}), std::runtime_error);
+
+    THEN("no value is destroyed and the stack keeps all its nodes"){
+      REQUIRE(ops::counts[ops::dtor] == 0);
+      REQUIRE(out.size() == 2);
+      REQUIRE(int(out[1]) == 4);
+      REQUIRE(pool.ssize(l) == 6);
+      REQUIRE(int(pool.value(pool.next(pool.next(l)))) == 3);
+      pool.emplace(pool.new_stack(), 9);
+      REQUIRE(pool.psize() == 7);
+    }
+
+    THEN("the stack can be popped again"){
+      l = pool.pop_n(l, 6, std::back_inserter(out));
+      REQUIRE(pool.empty(l));
+      REQUIRE(ops::counts[ops::dtor] == 6);
+      REQUIRE(int(out.back()) == 0);
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("giving memory back after a peak", "[layout]", aos_layout, soa_layout, segmented_layout<4>){
+  GIVEN("a pool that grew for a burst of work"){
+    stack_pool<int, uint16_t, TestType> pool{};
+    auto keep = pool.new_stack();
+    auto burst = pool.new_stack();
+    for (int i=0; i<10; ++i)
+      keep = pool.push(i, keep);
+    for (int i=0; i<1000; ++i)
+      burst = pool.push(i, burst);
+    auto hole = pool.new_stack();
+    for (int i=0; i<5; ++i)
+      hole = pool.push(i, hole);
+    auto tail = pool.push(42, pool.new_stack());
+    const auto peak = pool.allocated_bytes();
+
+    WHEN("the burst is over and the pool is shrunk"){
+      burst = pool.free_stack(burst);
+      hole = pool.free_stack(hole);
+      tail = pool.free_stack(tail);
+      const auto released = pool.shrink_to_fit();
+
+      THEN("the free nodes at the end are gone and their memory released"){
+        REQUIRE(pool.psize() == 10);
+        REQUIRE(released > 0);
+        REQUIRE(pool.allocated_bytes() == peak - released);
+        REQUIRE(pool.capacity() < 100);
+        REQUIRE(pool.ssize(keep) == 10);
+        REQUIRE(pool.value(keep) == 9);
+      }
+    }
+
+    WHEN("a node in use is at the end"){
+      burst = pool.free_stack(burst);
+      hole = pool.free_stack(hole);
+      pool.shrink_to_fit();
+
+      THEN("the pool keeps its size and reuses the free nodes from the front"){
+        REQUIRE(pool.psize() == 1016);
+        REQUIRE(pool.value(tail) == 42);
+        auto l = pool.push(0, pool.new_stack());
+        REQUIRE(l == 11);
+        l = pool.push(1, l);
+        REQUIRE(l == 12);
+        REQUIRE(pool.shrink_to_fit() == 0);
+      }
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("sorting a stack by relinking its nodes", "[layout]", aos_layout, soa_layout, segmented_layout<2>){
+  GIVEN("a stack of pairs with repeated keys, next to another stack"){
+    using item = std::pair<int, int>;
+    stack_pool<item, uint16_t, TestType> pool{};
+    auto other = pool.push(item{-1, -1}, pool.new_stack());
+    auto l = pool.new_stack();
+    const std::vector<int> keys{5, 3, 9, 3, 1, 5, 7, 3, 0, 9, 2};
+    for (int i=0; i<int(keys.size()); ++i)
+      l = pool.push(item{keys[i], i}, l);
+    other = pool.push(item{-2, -2}, other);
+    const auto by_key = [](const item& a, const item& b){ return a.first < b.first; };
+
+    WHEN("the stack is sorted"){
+      const auto n = pool.psize();
+      l = pool.sort_stack(l, by_key);
+
+      THEN("the keys are in order, equal keys keep their order and no node is added"){
+        std::vector<item> sorted(pool.cbegin(l), pool.cend(l));
+        REQUIRE(sorted.size() == keys.size());
+        REQUIRE(std::is_sorted(sorted.begin(), sorted.end(), by_key));
+        // pushed last means closer to the head
+        REQUIRE(sorted[3] == item{3, 7});
+        REQUIRE(sorted[4] == item{3, 3});
+        REQUIRE(sorted[5] == item{3, 1});
+        REQUIRE(pool.psize() == n);
+        REQUIRE(pool.ssize(other) == 2);
+      }
+
+      AND_WHEN("it is merged with another sorted stack and made unique"){
+        auto m = pool.new_stack();
+        for (int k : {8, 6, 4, 3})
+          m = pool.push(item{k, 100}, m);
+        l = pool.merge_sorted(l, m, by_key);
+        std::vector<item> merged(pool.cbegin(l), pool.cend(l));
+        REQUIRE(merged.size() == keys.size()+4);
+        REQUIRE(std::is_sorted(merged.begin(), merged.end(), by_key));
+        REQUIRE(merged[6] == item{3, 100});
+
+        const auto same_key = [](const item& a, const item& b){ return a.first == b.first; };
+        REQUIRE(pool.unique(l, same_key) == 5);
+        std::vector<int> left;
+        for (auto it = pool.cbegin(l); it != pool.cend(l); ++it)
+          left.push_back(it->first);
+        REQUIRE(left == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+        REQUIRE(pool.reach(l, 4) == item{3, 7});
+
+        THEN("the removed nodes are reused"){
+          const auto n = pool.psize();
+          auto f = pool.new_stack();
+          for (int i=0; i<5; ++i)
+            f = pool.push(item{i, i}, f);
+          REQUIRE(pool.psize() == n);
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("sorting through handles"){
+  stack_pool<int, uint16_t> pool{};
+  auto h = pool.new_handle();
+  REQUIRE(pool.empty(pool.sort_stack(h)));
+  h = pool.push(4, h);
+  h = pool.sort_stack(h);
+  REQUIRE(h.tail == h.head);
+
+  for (int v : {1, 7, 7, 2, 9})
+    h = pool.push(v, h);
+  h = pool.sort_stack(h, std::greater<int>{});
+  REQUIRE(std::vector<int>(pool.cbegin(h.head), pool.cend(h.head)) == std::vector<int>{9, 7, 7, 4, 2, 1});
+  REQUIRE(pool.value(h.tail) == 1);
+  REQUIRE(h.length == 6);
+
+  auto g = pool.new_handle();
+  for (int v : {0, 8})
+    g = pool.push(v, g);
+  h = pool.merge_sorted(h, g, std::greater<int>{});
+  REQUIRE(h.length == 8);
+  REQUIRE(pool.value(h.tail) == 0);
+  REQUIRE(pool.ssize(h.head) == 8);
+
+  h = pool.unique(h);
+  REQUIRE(h.length == 7);
+  REQUIRE(pool.value(h.tail) == 0);
+  REQUIRE(std::vector<int>(pool.cbegin(h.head), pool.cend(h.head)) == std::vector<int>{9, 8, 7, 4, 2, 1, 0});
+  REQUIRE(pool.merge_sorted(pool.new_handle(), h).head == h.head);
+}
+
+TEMPLATE_TEST_CASE("walking stacks with prefetching", "[layout]", aos_layout, soa_layout, segmented_layout<2>){
+  GIVEN("stacks of different lengths, some of them empty"){
+    stack_pool<int, uint16_t, TestType> pool{};
+    std::vector<uint16_t> heads(11, pool.new_stack());
+    for (int i=0; i<200; ++i){
+      const auto k = (i*7) % 11;
+      if (k % 4 != 1)
+        heads[k] = pool.push(i, heads[k]);
+    }
+    heads[5] = pool.push(-1, heads[5]);
+    std::vector<std::vector<int>> expected;
+    for (auto h : heads)
+      expected.emplace_back(pool.cbegin(h), pool.cend(h));
+
+    THEN("the prefetching iterators see what the plain ones see"){
+      for (std::size_t k=0; k<heads.size(); ++k){
+        REQUIRE(std::vector<int>(pool.pbegin(heads[k]), pool.pend(heads[k])) == expected[k]);
+        const auto& cpool = pool;
+        REQUIRE(std::vector<int>(cpool.pbegin(heads[k]), cpool.pend(heads[k])) == expected[k]);
+      }
+      auto it = pool.pbegin(heads[0]);
+      *it = 1000;
+      REQUIRE(pool.value(heads[0]) == 1000);
+      REQUIRE_THROWS(pool.pbegin(1000));
+    }
+
+    THEN("for_each visits a stack from the head on"){
+      std::vector<int> seen;
+      pool.for_each(heads[3], [&seen](int v){ seen.push_back(v); });
+      REQUIRE(seen == expected[3]);
+      pool.for_each(heads[3], [](int& v){ v = -v; });
+      REQUIRE(pool.value(heads[3]) == -expected[3][0]);
+      REQUIRE_THROWS(pool.for_each(1000, [](int){}));
+    }
+
+    THEN("walking in lockstep visits each stack in order"){
+      for (std::size_t w : {1, 3, 8}){
+        std::vector<std::vector<int>> seen(heads.size());
+        const auto collect = [&seen](std::size_t k, int v){ seen[k].push_back(v); };
+        if (w == 1)
+          pool.template for_each_lockstep<1>(heads.begin(), heads.end(), collect);
+        else if (w == 3)
+          pool.template for_each_lockstep<3>(heads.begin(), heads.end(), collect);
+        else
+          pool.for_each_lockstep(heads.cbegin(), heads.cend(), collect);
+        REQUIRE(seen == expected);
+      }
+      std::vector<uint16_t> bad{heads[0], 1000};
+      REQUIRE_THROWS(pool.for_each_lockstep(bad.begin(), bad.end(), [](std::size_t, int){}));
+    }
+  }
+}
+
+SCENARIO("compacting a fragmented pool"){
+  GIVEN("three stacks interleaved with freed ones"){
+    stack_pool<int, uint16_t, segmented_layout<2>> pool{};
+    std::vector<uint16_t> heads(6, pool.new_stack());
+    for (int i=0; i<60; ++i)
+      heads[i % 6] = pool.push(i, heads[i % 6]);
+    heads[1] = pool.free_stack(heads[1]);
+    heads[4] = pool.free_stack(heads[4]);
+    heads[3] = pool.pop(heads[3]);
+    std::vector<uint16_t> live{heads[5], heads[0], heads[3], heads[2]};
+
+    std::vector<std::vector<int>> before;
+    for (auto h : live)
+      before.emplace_back(pool.cbegin(h), pool.cend(h));
+
+    auto check = [&](const std::vector<uint16_t>& after){
+      REQUIRE(pool.psize() == 39);
+      uint16_t x = 1;
+      for (std::size_t k=0; k<after.size(); ++k){
+        REQUIRE(after[k] == x);
+        REQUIRE(std::vector<int>(pool.cbegin(after[k]), pool.cend(after[k])) == before[k]);
+        for (auto y = after[k]; !pool.empty(y); y = pool.next(y), ++x)
+          REQUIRE(y == x);
+      }
+      REQUIRE(x == 40);
+    };
+
+    WHEN("it is compacted at once"){
+      auto after = pool.compact(live, true);
+
+      THEN("each stack is a contiguous run and the garbage is gone"){
+        check(after);
+        REQUIRE(pool.capacity() == 40);
+      }
+
+      THEN("the pool grows again from its end"){
+        after[0] = pool.push(100, after[0]);
+        REQUIRE(after[0] == 40);
+        REQUIRE(pool.ssize(after[0]) == 11);
+      }
+    }
+
+    WHEN("it is compacted one node at a time"){
+      auto c = pool.start_compaction(live);
+      std::size_t steps = 0;
+      while (!c.step(1)){
+        ++steps;
+        for (std::size_t k=0; k<live.size(); ++k)
+          REQUIRE(pool.ssize(c.heads()[k]) == before[k].size());
+      }
+
+      THEN("the result is the same"){
+        REQUIRE(steps >= 2 * 39);
+        check(c.heads());
+      }
+    }
+
+    WHEN("the pool changes between two steps"){
+      auto c = pool.start_compaction(live);
+      c.step(1);
+      pool.push(0, pool.new_stack());
+
+      THEN("the next step throws"){
+        REQUIRE_THROWS(c.step(1));
+      }
+    }
+
+    WHEN("two heads share a node"){
+      auto shared = pool.push(0, live[0]);
+      THEN("the compaction throws"){
+        REQUIRE_THROWS(pool.compact({shared, live[0]}));
+      }
+
+      THEN("the free nodes are still reused afterwards"){
+        REQUIRE_THROWS(pool.compact({shared, live[0]}));
+        auto c = pool.start_compaction({live[0], shared});
+        REQUIRE_THROWS(c.step(100));
+        auto l = pool.new_stack();
+        for (int i=0; i<20; ++i)
+          l = pool.push(i, l);
+        REQUIRE(pool.psize() == 60);
+        REQUIRE(pool.ssize(l) == 20);
+        REQUIRE(pool.ssize(live[0]) == 10);
+      }
+    }
+  }
+}
+
+SCENARIO("reopening a memory-mapped pool"){
+  using pool_t = stack_pool<int, uint32_t, mapped_layout<4096>>;
+  const std::string path = "tests_mapped.pool";
+  std::remove(path.c_str());
+
+  GIVEN("a pool stored in a file"){
+    uint32_t l1, l2;
+    {
+      pool_t pool{path};
+      l1 = pool.new_stack();
+      l2 = pool.new_stack();
+      for (int i=0; i<2000; ++i){
+        l1 = pool.push(i, l1);
+        l2 = pool.push(-i, l2);
+      }
+      REQUIRE(pool.capacity() >= 4000);
+      l2 = pool.free_stack(l2);
+      pool.root() = l1;
+      pool.sync();
+    }
+
+    WHEN("we open it again"){
+      pool_t pool{path};
+
+      THEN("stacks and free nodes are still there"){
+        REQUIRE(pool.root() == l1);
+        REQUIRE(pool.psize() == 4000);
+        REQUIRE(pool.ssize(l1) == 2000);
+        REQUIRE(pool.value(l1) == 1999);
+        REQUIRE(pool.reach(l1, 2000) == 0);
+
+        auto l3 = pool.new_stack();
+        for (int i=0; i<2000; ++i)
+          l3 = pool.push(i, l3);
+        REQUIRE(pool.psize() == 4000);
+      }
+    }
+
+    WHEN("we open it with a different value type"){
+      THEN("it throws"){
+        REQUIRE_THROWS((stack_pool<double, uint32_t, mapped_layout<4096>>{path}));
+      }
+    }
+  }
+
+  GIVEN("a full pool growing by small extents"){
+    stack_pool<long, uint32_t, mapped_layout<4*sizeof(long)>> pool{path};
+    auto l = pool.new_stack();
+    for (long i=0; i<4; ++i)
+      l = pool.push(10*i, l);
+    const auto cap = pool.capacity();
+    REQUIRE(pool.psize() == cap);
+
+    WHEN("a value of the pool is pushed again"){
+      l = pool.push(pool.value(l), l);
+      l = pool.push(pool.value(pool.next(l)), l);
+
+      THEN("it is copied before the file is mapped again"){
+        REQUIRE(pool.capacity() > cap);
+        REQUIRE(pool.value(l) == 30);
+        REQUIRE(pool.value(pool.next(l)) == 30);
+        REQUIRE(pool.ssize(l) == 6);
+      }
+    }
+  }
+  std::remove(path.c_str());
+}
@@ -0,0 +1,191 @@
+#include "catch.hpp"
+
+#include "pool_allocator.hpp"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+SCENARIO("slots of a slot_arena"){
+  GIVEN("an arena"){
+    slot_arena arena{};
+    const auto size = slot_arena::slot_size(24, 8);
+    REQUIRE(size == 24);
+    const std::size_t granularity = slot_arena::granularity;
+    REQUIRE(slot_arena::slot_size(1, 1) == granularity);
+    REQUIRE(slot_arena::slot_size(20, 16) == 32);
+
+    WHEN("slots are allocated"){
+      std::vector<char*> slots;
+      for (int i=0; i<100; ++i)
+        slots.push_back(static_cast<char*>(arena.allocate(size)));
+      THEN("they are side by side in the blocks"){
+        REQUIRE(slots[1] - slots[0] == 24);
+        REQUIRE(slots[63] - slots[0] == 63*24);
+        const std::size_t first = slot_arena::first_slots;
+        REQUIRE(arena.allocated_bytes() == (first + 2*first)*24);
+      }
+
+      AND_WHEN("slots are given back"){
+        arena.deallocate(slots[10], size);
+        arena.deallocate(slots[20], size);
+        THEN("they are reused last in, first out, before the end of the block"){
+          REQUIRE(arena.allocate(size) == slots[20]);
+          REQUIRE(arena.allocate(size) == slots[10]);
+          REQUIRE(arena.allocate(size) == slots[99] + 24);
+        }
+      }
+
+      AND_WHEN("slots of another size are allocated"){
+        auto p = arena.allocate(slot_arena::slot_size(40, 8));
+        arena.deallocate(slots[0], size);
+        THEN("they come from blocks of their own"){
+          REQUIRE(arena.allocate(slot_arena::slot_size(40, 8)) != slots[0]);
+          arena.deallocate(p, slot_arena::slot_size(40, 8));
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("pool_allocator as the allocator of node containers"){
+  GIVEN("a std::set with a pool_allocator"){
+    std::set<int, std::less<int>, pool_allocator<int>> set{};
+    for (int i=0; i<1000; ++i)
+      set.insert((i*37) % 1000);
+    const auto bytes = set.get_allocator().get_arena()->allocated_bytes();
+
+    THEN("it works as a std::set"){
+      REQUIRE(set.size() == 1000);
+      REQUIRE(*set.begin() == 0);
+      REQUIRE(*set.rbegin() == 999);
+      REQUIRE(bytes > 0);
+    }
+
+    WHEN("its nodes are erased and inserted again"){
+      for (int i=0; i<1000; i+=2)
+        set.erase(i);
+      for (int i=0; i<1000; i+=2)
+        set.insert(i + 1000);
+      THEN("the freed slots are reused"){
+        REQUIRE(set.size() == 1000);
+        REQUIRE(set.get_allocator().get_arena()->allocated_bytes() == bytes);
+      }
+    }
+
+    WHEN("it is copied"){
+      auto copy = set;
+      THEN("the copy shares the arena"){
+        REQUIRE(copy == set);
+        REQUIRE(copy.get_allocator() == set.get_allocator());
+      }
+    }
+
+    WHEN("it is moved from"){
+      auto moved = std::move(set);
+      set.insert(4);
+      set.insert(-1);
+      THEN("the moved-from set still allocates from the arena"){
+        REQUIRE(set.get_allocator() == moved.get_allocator());
+        REQUIRE(set.size() == 2);
+        REQUIRE(*set.begin() == -1);
+        REQUIRE(moved.size() == 1000);
+      }
+    }
+  }
+
+  GIVEN("containers sharing an allocator"){
+    pool_allocator<int> alloc{};
+    std::list<std::string, pool_allocator<std::string>> list{alloc};
+    std::map<std::string, int, std::less<std::string>, pool_allocator<std::pair<const std::string, int>>> map{alloc};
+    for (int i=0; i<100; ++i){
+      list.push_back(std::to_string(i));
+      map[std::to_string(i)] = i;
+    }
+
+    THEN("they use the same arena"){
+      REQUIRE(list.size() == 100);
+      REQUIRE(map.size() == 100);
+      REQUIRE(map["42"] == 42);
+      REQUIRE(list.back() == "99");
+      REQUIRE(list.get_allocator() == alloc);
+      REQUIRE(map.get_allocator() == alloc);
+      REQUIRE(alloc.get_arena()->allocated_bytes() > 0);
+      REQUIRE(alloc != pool_allocator<int>{});
+    }
+
+    WHEN("two lists are swapped or moved"){
+      std::list<std::string, pool_allocator<std::string>> other{};
+      other.push_back("x");
+      list.swap(other);
+      THEN("the allocators follow them"){
+        REQUIRE(other.size() == 100);
+        REQUIRE(other.get_allocator() == alloc);
+        REQUIRE(list.get_allocator() != alloc);
+        list = std::move(other);
+        REQUIRE(list.get_allocator() == alloc);
+        REQUIRE(list.front() == "0");
+      }
+    }
+
+    WHEN("the containers are moved from"){
+      auto moved_list = std::move(list);
+      auto moved_map = std::move(map);
+      list.push_back("a");
+      list.push_back("b");
+      map["a"] = 1;
+      THEN("the moved-from ones keep the arena and are still usable"){
+        REQUIRE(list.get_allocator() == alloc);
+        REQUIRE(map.get_allocator() == moved_map.get_allocator());
+        REQUIRE(list.size() == 2);
+        REQUIRE(list.back() == "b");
+        REQUIRE(map.size() == 1);
+        REQUIRE(moved_list.size() == 100);
+        REQUIRE(moved_map.size() == 100);
+      }
+    }
+  }
+
+  GIVEN("allocations that do not fit a slot"){
+    pool_allocator<double> alloc{};
+    struct large{ char c[300]; };
+    pool_allocator<large> large_alloc{alloc};
+
+    THEN("they go to operator new"){
+      std::vector<double, pool_allocator<double>> v(1000, 1.5, alloc);
+      auto p = large_alloc.allocate(1);
+      large_alloc.deallocate(p, 1);
+      REQUIRE(v[999] == 1.5);
+      REQUIRE(alloc.get_arena()->allocated_bytes() == 0);
+    }
+  }
+}
+
+SCENARIO("random inserts and erases against std::set"){
+  GIVEN("a pooled std::multiset and a plain one"){
+    std::multiset<std::uint64_t, std::less<std::uint64_t>, pool_allocator<std::uint64_t>> pooled{};
+    std::multiset<std::uint64_t> ref{};
+    std::mt19937_64 gen{3};
+    for (int i=0; i<20000; ++i){
+      const auto v = gen() % 500;
+      if (gen() % 3 == 0){
+        pooled.erase(v);
+        ref.erase(v);
+      }else{
+        pooled.insert(v);
+        ref.insert(v);
+      }
+    }
+    THEN("they hold the same values"){
+      REQUIRE(std::vector<std::uint64_t>(pooled.begin(), pooled.end()) ==
+              std::vector<std::uint64_t>(ref.begin(), ref.end()));
+    }
+  }
+}
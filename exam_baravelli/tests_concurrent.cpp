@@ -0,0 +1,144 @@
+#include "catch.hpp"
+
+#include "concurrent_stack_pool.hpp"
+#include <algorithm> // max_element
+#include <stdexcept> // runtime_error
+#include <thread>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+SCENARIO("concurrent pool behaves like stack_pool on a single thread"){
+  concurrent_stack_pool<int, std::uint32_t> pool{};
+  auto l = pool.new_stack();
+  REQUIRE(l == pool.end());
+
+  l = pool.push(10, l);
+  REQUIRE(l == 1u);
+  l = pool.push(11, l);
+  REQUIRE(l == 2u);
+
+  auto l2 = pool.new_stack();
+  l2 = pool.push(20, l2);
+  REQUIRE(l2 == 3u);
+
+  l = pool.pop(l);
+  l2 = pool.push(21, l2);
+  // the popped node is recycled
+  REQUIRE(l2 == 2u);
+  REQUIRE(pool.value(l2) == 21);
+  REQUIRE(pool.value(pool.next(l2)) == 20);
+
+  REQUIRE(*std::max_element(pool.begin(l2), pool.end(l2)) == 21);
+
+  l2 = pool.free_stack(l2);
+  REQUIRE(pool.empty(l2));
+  REQUIRE(pool.psize() == 3);
+}
+
+// value whose default construction, hence the allocation of a block, throws on demand
+struct fragile{
+  static bool fail;
+  int v{0};
+  fragile(){ if (fail) throw std::runtime_error{"no block"}; }
+  fragile(int x) : v{x} {}
+};
+bool fragile::fail = false;
+
+SCENARIO("a block that cannot be allocated"){
+  concurrent_stack_pool<fragile, std::uint32_t> pool{};
+  auto l = pool.new_stack();
+  fragile::fail = true;
+  REQUIRE_THROWS_AS(pool.push(fragile{1}, l), std::runtime_error);
+
+  THEN("no index is handed out without its block"){
+    REQUIRE(pool.psize() == 0);
+    REQUIRE_THROWS(pool.value(1));
+    fragile::fail = false;
+    l = pool.push(fragile{2}, l);
+    REQUIRE(l == 1u);
+    REQUIRE(pool.value(l).v == 2);
+    REQUIRE(pool.psize() == 1);
+  }
+  fragile::fail = false;
+}
+
+SCENARIO("many threads working on their own stacks"){
+  GIVEN("a pool shared by some threads"){
+    concurrent_stack_pool<int, std::uint32_t> pool{};
+    const int n_threads = 4;
+    const int n = 20000;
+    std::vector<long> sums(n_threads);
+
+    WHEN("each thread pushes, pops and frees its own stacks"){
+      std::vector<std::thread> threads;
+      for (int t=0; t<n_threads; ++t)
+        threads.emplace_back([&pool, &sums, t, n]{
+          for (int round=0; round<3; ++round){
+            auto l = pool.new_stack();
+            for (int i=0; i<n; ++i)
+              l = pool.push(i, l);
+            for (int i=0; i<n/2; ++i)
+              l = pool.pop(l);
+            long s = 0;
+            for (auto it = pool.begin(l); it != pool.end(l); ++it)
+              s += *it;
+            sums[t] = s;
+            l = pool.free_stack(l);
+          }
+        });
+      for (auto& th : threads)
+        th.join();
+
+      THEN("every stack held its own values"){
+        const long expected = long(n/2) * (n/2 - 1) / 2;
+        for (auto s : sums)
+          REQUIRE(s == expected);
+      }
+      THEN("freed nodes were recycled instead of growing the pool"){
+        REQUIRE(pool.psize() <= std::size_t(n_threads * n));
+        REQUIRE(pool.psize() >= std::size_t(n));
+      }
+    }
+  }
+}
+
+SCENARIO("a shared Treiber stack"){
+  GIVEN("a pool and a shared stack"){
+    concurrent_stack_pool<int, std::uint32_t> pool{};
+    concurrent_stack_pool<int, std::uint32_t>::shared_stack s;
+    const int n_threads = 4;
+    const int n = 10000;
+
+    WHEN("many threads push and pop concurrently"){
+      std::vector<long> popped(n_threads);
+      std::vector<std::thread> threads;
+      for (int t=0; t<n_threads; ++t)
+        threads.emplace_back([&pool, &s, &popped, t, n]{
+          for (int i=1; i<=n; ++i){
+            pool.push(s, i);
+            int v;
+            if (i % 2 == 0 && pool.try_pop(s, v))
+              popped[t] += v;
+          }
+        });
+      for (auto& th : threads)
+        th.join();
+
+      long rest = 0;
+      int v;
+      while (pool.try_pop(s, v))
+        rest += v;
+
+      THEN("each pushed value is popped exactly once"){
+        long total = rest;
+        for (auto p : popped)
+          total += p;
+        REQUIRE(total == long(n_threads) * n * (n+1) / 2);
+        REQUIRE(pool.empty(s));
+      }
+    }
+  }
+}
@@ -0,0 +1,115 @@
+#include "catch.hpp"
+
+#include "generational_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+SCENARIO("catching stale heads through their generation"){
+  GIVEN("a pool with two stacks"){
+    generational_pool<int, std::uint32_t, 8> pool{};
+    auto l = pool.new_stack();
+    REQUIRE(pool.valid(l));
+    for (int i=0; i<3; ++i)
+      l = pool.push(i, l);
+    auto m = pool.push(10, pool.new_stack());
+
+    THEN("fresh heads carry the position and generation 0"){
+      REQUIRE(pool.index(l) == 3u);
+      REQUIRE(pool.generation(l) == 0u);
+      REQUIRE(pool.value(l) == 2);
+      REQUIRE(pool.value(pool.next(l)) == 1);
+      REQUIRE(pool.ssize(l) == 3);
+      REQUIRE(pool.reach(l, 3) == 0);
+    }
+
+    WHEN("a node is popped"){
+      const auto old = l;
+      l = pool.pop(l);
+
+      THEN("the old head is stale"){
+        REQUIRE_FALSE(pool.valid(old));
+        REQUIRE_THROWS(pool.pop(old));
+        REQUIRE_THROWS(pool.value(old));
+        REQUIRE_THROWS(pool.push(5, old));
+        REQUIRE(pool.value(l) == 1);
+      }
+
+      AND_WHEN("the node is reused by another stack"){
+        m = pool.push(11, m);
+        THEN("it has a new generation and the old head is still stale"){
+          REQUIRE(pool.index(m) == pool.index(old));
+          REQUIRE(pool.generation(m) == 1u);
+          REQUIRE_FALSE(pool.valid(old));
+          REQUIRE_THROWS(pool.free_stack(old));
+          REQUIRE(pool.ssize(m) == 2);
+        }
+      }
+    }
+
+    WHEN("a stack is freed"){
+      const auto below = pool.next(l);
+      const auto old = l;
+      l = pool.free_stack(l);
+
+      THEN("the heads of all its nodes are stale"){
+        REQUIRE(pool.empty(l));
+        REQUIRE_FALSE(pool.valid(old));
+        REQUIRE_FALSE(pool.valid(below));
+        REQUIRE_THROWS(pool.free_stack(old));
+        REQUIRE(pool.valid(m));
+        REQUIRE(pool.value(m) == 10);
+      }
+    }
+
+    THEN("heads past the pool or the end with a generation are invalid"){
+      REQUIRE_FALSE(pool.valid(100));
+      REQUIRE_FALSE(pool.valid(std::uint32_t(1) << 24));
+      REQUIRE_THROWS(pool.value(pool.end()));
+      REQUIRE_THROWS(pool.pop(pool.end()));
+    }
+  }
+}
+
+SCENARIO("generations and positions share the bits of the head"){
+  GIVEN("heads of 8 bits, 4 of them for the generation"){
+    generational_pool<int, std::uint8_t, 4> pool{};
+    REQUIRE(pool.max_index == 15);
+
+    THEN("the pool cannot grow past 15 nodes"){
+      auto l = pool.new_stack();
+      for (int i=0; i<15; ++i)
+        l = pool.push(i, l);
+      REQUIRE_THROWS(pool.push(15, l));
+      REQUIRE(pool.ssize(l) == 15);
+      l = pool.pop(l);
+      REQUIRE_NOTHROW(l = pool.push(15, l));
+    }
+
+    THEN("the generation wraps around after 16 reuses"){
+      auto l = pool.push(0, pool.new_stack());
+      const auto first = l;
+      for (int i=0; i<15; ++i){
+        l = pool.pop(l);
+        l = pool.push(i, l);
+        REQUIRE_FALSE(pool.valid(first));
+      }
+      l = pool.pop(l);
+      l = pool.push(0, l);
+      REQUIRE(l == first);
+    }
+  }
+}
+
+SCENARIO("generational pools hold any value"){
+  generational_pool<std::string, std::uint64_t> pool{8};
+  auto l = pool.emplace(pool.new_stack(), 3, 'a');
+  l = pool.push("bb", l);
+  REQUIRE(pool.value(pool.next(l)) == "aaa");
+  l = pool.free_stack(l);
+  REQUIRE(pool.psize() == 2);
+}
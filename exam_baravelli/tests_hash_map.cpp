@@ -0,0 +1,223 @@
+#include "catch.hpp"
+
+#include "pool_hash_map.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+// hash of std::string accepting C strings too, without building a std::string
+struct string_hash{
+  using is_transparent = void;
+  std::size_t operator()(const char* s) const{
+    std::size_t h = 14695981039346656037ull;
+    for (; *s; ++s)
+      h = (h ^ static_cast<unsigned char>(*s)) * 1099511628211ull;
+    return h;
+  }
+  std::size_t operator()(const std::string& s) const{ return (*this)(s.c_str()); }
+};
+
+// hash sending every key to the same bucket
+struct constant_hash{
+  std::size_t operator()(int) const{ return 0; }
+};
+
+template <typename M>
+std::map<typename M::key_type, typename M::mapped_type> sorted(const M& m){
+  return std::map<typename M::key_type, typename M::mapped_type>(m.begin(), m.end());
+}
+
+SCENARIO("inserting, finding and erasing keys"){
+  GIVEN("a map with a few words"){
+    pool_hash_map<std::string, int> map{};
+    REQUIRE(map.empty());
+    REQUIRE(map.bucket_count() == 8);
+    map["one"] = 1;
+    map["two"] = 2;
+    REQUIRE(map.insert({"three", 3}).second);
+    REQUIRE_FALSE(map.insert({"two", 20}).second);
+
+    THEN("the keys are found"){
+      REQUIRE(map.size() == 3);
+      REQUIRE(map.at("two") == 2);
+      REQUIRE(map.find("three")->second == 3);
+      REQUIRE(map.contains("one"));
+      REQUIRE(map.count("four") == 0);
+      REQUIRE(map.find("four") == map.end());
+      REQUIRE_THROWS(map.at("four"));
+      REQUIRE(sorted(map) == std::map<std::string, int>{{"one", 1}, {"three", 3}, {"two", 2}});
+    }
+
+    WHEN("a key is erased"){
+      REQUIRE(map.erase("two") == 1);
+      REQUIRE(map.erase("two") == 0);
+      THEN("it is gone and its node is reused"){
+        REQUIRE(map.size() == 2);
+        REQUIRE_FALSE(map.contains("two"));
+        const auto nodes = map.pool().psize();
+        map["four"] = 4;
+        REQUIRE(map.pool().psize() == nodes);
+        REQUIRE(sorted(map) == std::map<std::string, int>{{"four", 4}, {"one", 1}, {"three", 3}});
+      }
+    }
+
+    WHEN("the map is cleared"){
+      map.clear();
+      THEN("it is empty and keeps its nodes"){
+        REQUIRE(map.empty());
+        REQUIRE(map.begin() == map.end());
+        map["five"] = 5;
+        REQUIRE(map.pool().psize() == 3);
+        REQUIRE(map.size() == 1);
+      }
+    }
+  }
+
+  GIVEN("a map whose keys all collide"){
+    pool_hash_map<int, int, constant_hash> map{};
+    for (int i=0; i<6; ++i)
+      map[i] = i*i;
+
+    WHEN("values are erased from the middle, the top and the bottom of the bucket"){
+      map.erase(3);
+      map.erase(5);
+      map.erase(0);
+      THEN("the chain is relinked"){
+        REQUIRE(sorted(map) == std::map<int, int>{{1, 1}, {2, 4}, {4, 16}});
+      }
+    }
+
+    WHEN("values are erased through iterators"){
+      for (auto it = map.begin(); it != map.end();)
+        it = it->first % 2 == 0 ? map.erase(it) : std::next(it);
+      THEN("the others are left"){
+        REQUIRE(sorted(map) == std::map<int, int>{{1, 1}, {3, 9}, {5, 25}});
+        REQUIRE_THROWS(map.erase(map.cend()));
+      }
+    }
+  }
+}
+
+SCENARIO("incremental rehash"){
+  GIVEN("a map filled past its load factor"){
+    pool_hash_map<int, int> map{};
+    map.max_load_factor(1.0f);
+    for (int i=0; i<9; ++i)
+      map[i] = i;
+
+    THEN("the buckets are doubled and migrated a few at a time"){
+      REQUIRE(map.bucket_count() == 16);
+      REQUIRE(map.rehashing());
+      for (int i=0; i<9; ++i)
+        REQUIRE(map.at(i) == i);
+      REQUIRE(sorted(map).size() == 9);
+      map[9] = 9;
+      REQUIRE(map.rehashing());
+      REQUIRE(sorted(map).size() == 10);
+      map[10] = 10;
+      REQUIRE_FALSE(map.rehashing());
+      REQUIRE(sorted(map).size() == 11);
+      REQUIRE(map.at(3) == 3);
+    }
+
+    WHEN("a rehash is asked"){
+      map.rehash(100);
+      THEN("the buckets are rebuilt at once"){
+        REQUIRE(map.bucket_count() == 128);
+        REQUIRE_FALSE(map.rehashing());
+        for (int i=0; i<9; ++i)
+          REQUIRE(map.at(i) == i);
+      }
+    }
+  }
+
+  GIVEN("a map with a small max load factor"){
+    pool_hash_map<int, int> map{};
+    map.max_load_factor(0.1f);
+
+    THEN("each rehash is over before the next doubling, but in tiny tables"){
+      for (int i=0; i<5000; ++i){
+        const auto buckets = map.bucket_count();
+        const bool was_rehashing = map.rehashing();
+        map[i] = i;
+        if (map.bucket_count() != buckets && buckets > 20)
+          REQUIRE_FALSE(was_rehashing);
+      }
+      REQUIRE(map.bucket_count() >= 50000);
+      REQUIRE(map.at(1234) == 1234);
+    }
+  }
+
+  GIVEN("a map against std::unordered_map under random inserts and erases"){
+    pool_hash_map<std::uint32_t, int, std::hash<std::uint32_t>, std::equal_to<std::uint32_t>, std::uint32_t> map{};
+    std::unordered_map<std::uint32_t, int> ref{};
+    std::mt19937 gen{11};
+    for (int i=0; i<50000; ++i){
+      const auto k = gen() % 4000;
+      if (gen() % 3 == 0){
+        REQUIRE(map.erase(k) == ref.erase(k));
+      }else{
+        map[k] += i;
+        ref[k] += i;
+      }
+      if (i % 5000 == 0)
+        REQUIRE(map.size() == ref.size());
+    }
+    THEN("they hold the same values"){
+      REQUIRE(map.size() == ref.size());
+      REQUIRE(sorted(map) == std::map<std::uint32_t, int>(ref.begin(), ref.end()));
+      REQUIRE(map.load_factor() <= map.max_load_factor());
+    }
+  }
+
+  GIVEN("a map with reserved room"){
+    pool_hash_map<int, int> map{1000};
+    THEN("no rehash happens while filling it"){
+      const auto buckets = map.bucket_count();
+      REQUIRE(buckets >= 1000);
+      for (int i=0; i<1000; ++i)
+        map.try_emplace(i, -i);
+      REQUIRE(map.bucket_count() == buckets);
+      REQUIRE(map.pool().capacity() >= 1000);
+      REQUIRE(map.at(999) == -999);
+    }
+  }
+}
+
+SCENARIO("heterogeneous lookup"){
+  GIVEN("a map of strings with a transparent hash"){
+    pool_hash_map<std::string, int, string_hash, std::equal_to<>> map{};
+    REQUIRE(map.transparent);
+    REQUIRE_FALSE(pool_hash_map<std::string, int>::transparent);
+    map.try_emplace("alpha", 1);
+    map[std::string{"beta"}] = 2;
+
+    THEN("C strings are looked up without building a std::string"){
+      const char* key = "alpha";
+      REQUIRE(map.find(key)->second == 1);
+      REQUIRE(map.count("beta") == 1);
+      REQUIRE_FALSE(map.contains("gamma"));
+      REQUIRE(map.at("beta") == 2);
+    }
+
+    WHEN("a C string key is inserted"){
+      char buffer[] = "gamma";
+      ++map[static_cast<const char*>(buffer)];
+      std::strcpy(buffer, "delta");
+      THEN("the map keeps its own copy"){
+        REQUIRE(map.at("gamma") == 1);
+        REQUIRE_FALSE(map.contains("delta"));
+        REQUIRE(map.size() == 3);
+      }
+    }
+  }
+}
@@ -0,0 +1,121 @@
+#include "catch.hpp"
+
+#include "indexed_pool.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+// every position of every stack, through the index and through a plain walk
+template <typename I>
+void require_same_as_walking(const I& ipool, const std::vector<typename I::stack_type>& heads){
+  for (auto h : heads){
+    const auto n = ipool.pool().ssize(h);
+    REQUIRE(ipool.ssize(h) == n);
+    REQUIRE(ipool.advance(h, n) == ipool.end());
+    for (std::size_t m = 1; m <= n; ++m)
+      REQUIRE(ipool.reach(h, m) == ipool.pool().reach(h, m));
+  }
+}
+
+SCENARIO("reaching deep nodes through the jump index"){
+  GIVEN("an indexed pool with one long stack"){
+    indexed_pool<int, std::uint32_t> pool{};
+    auto l = pool.new_stack();
+    for (int i=0; i<1000; ++i)
+      l = pool.push(i, l);
+
+    THEN("advance and reach agree with the stack"){
+      REQUIRE(pool.ssize(l) == 1000);
+      REQUIRE(pool.advance(l, 0) == l);
+      REQUIRE(pool.value(pool.advance(l, 1)) == 998);
+      REQUIRE(pool.reach(l, 1) == 999);
+      REQUIRE(pool.reach(l, 0) == 999);
+      REQUIRE(pool.reach(l, 1000) == 0);
+      REQUIRE(pool.reach(l, 300) == 700);
+      REQUIRE(pool.advance(l, 1000) == pool.end());
+      REQUIRE_THROWS(pool.advance(l, 1001));
+      REQUIRE_THROWS(pool.reach(l, 1001));
+      REQUIRE_THROWS(pool.reach(pool.end(), 1));
+      REQUIRE_THROWS(pool.advance(1001, 0));
+    }
+
+    WHEN("nodes are popped and pushed again"){
+      for (int i=0; i<10; ++i)
+        l = pool.pop(l);
+      auto m = pool.new_stack();
+      for (int i=0; i<20; ++i)
+        m = pool.emplace(m, -i);
+
+      THEN("recycled nodes are indexed on their new stack"){
+        REQUIRE(pool.ssize(l) == 990);
+        REQUIRE(pool.ssize(m) == 20);
+        REQUIRE(pool.reach(m, 20) == 0);
+        REQUIRE(pool.reach(l, 990) == 0);
+        require_same_as_walking(pool, {l, m});
+      }
+    }
+  }
+}
+
+SCENARIO("keeping the index right after bulk operations"){
+  GIVEN("an indexed pool with a few stacks and some free nodes"){
+    indexed_pool<int, std::uint16_t> pool{};
+    std::vector<std::uint16_t> heads(4, pool.new_stack());
+    for (int i=0; i<200; ++i)
+      heads[i % 4] = pool.push(i, heads[i % 4]);
+    heads[3] = pool.free_stack(heads[3]);
+    const std::vector<int> values(70, 7);
+
+    WHEN("a range is pushed on free and new nodes"){
+      heads[3] = pool.push_range(values.begin(), values.end(), heads[3]);
+      heads[0] = pool.push_range(values.begin(), values.begin()+10, heads[0]);
+      THEN("the new nodes are indexed when used"){
+        REQUIRE(pool.ssize(heads[3]) == 70);
+        REQUIRE(pool.ssize(heads[0]) == 60);
+        require_same_as_walking(pool, heads);
+      }
+    }
+
+    WHEN("two stacks are spliced"){
+      const auto j = pool.splice(heads[1], heads[2]);
+      THEN("the depths of the moved nodes are recomputed"){
+        REQUIRE(pool.ssize(j) == 100);
+        REQUIRE(pool.reach(j, 51) == 198);
+        require_same_as_walking(pool, {heads[0], j});
+        REQUIRE(pool.splice(pool.end(), j) == j);
+      }
+    }
+
+    WHEN("the pool is compacted"){
+      heads = pool.compact(heads, true);
+      THEN("the stacks are indexed at their new place"){
+        REQUIRE(pool.psize() == 150);
+        require_same_as_walking(pool, heads);
+      }
+    }
+  }
+}
+
+SCENARIO("random operations keep the index consistent"){
+  indexed_pool<int, std::uint32_t> pool{};
+  std::vector<std::uint32_t> heads(8, pool.new_stack());
+  std::mt19937 gen{7};
+  std::uniform_int_distribution<int> which{0, 7}, op{0, 9};
+  for (int i=0; i<5000; ++i){
+    auto& h = heads[which(gen)];
+    const auto o = op(gen);
+    if (o < 6 || pool.empty(h))
+      h = pool.push(i, h);
+    else if (o < 8)
+      h = pool.pop(h);
+    else if (o < 9)
+      REQUIRE(pool.value(pool.advance(h, pool.ssize(h)/2)) == pool.pool().reach(h, pool.ssize(h)/2+1));
+    else
+      h = pool.free_stack(h);
+  }
+  require_same_as_walking(pool, heads);
+}
@@ -0,0 +1,240 @@
+#include "catch.hpp"
+
+#include "list_pool.hpp"
+#include <cstdint>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+template <typename P>
+std::vector<int> values(const P& pool, const typename P::list& l){
+  return std::vector<int>(pool.cbegin(l), pool.cend(l));
+}
+
+template <typename P>
+std::vector<int> reversed(const P& pool, const typename P::list& l){
+  return std::vector<int>(pool.crbegin(l), pool.crend(l));
+}
+
+SCENARIO("inserting and erasing in the middle of a list"){
+  GIVEN("a list with the values 0 to 4"){
+    list_pool<int, std::uint32_t> pool{};
+    auto l = pool.new_list();
+    REQUIRE(pool.empty(l));
+    std::vector<std::uint32_t> nodes;
+    for (int i=0; i<5; ++i)
+      nodes.push_back(pool.push_back(l, i));
+
+    THEN("it is walked both ways"){
+      REQUIRE(values(pool, l) == std::vector<int>{0, 1, 2, 3, 4});
+      REQUIRE(reversed(pool, l) == std::vector<int>{4, 3, 2, 1, 0});
+      REQUIRE(pool.size(l) == 5);
+      REQUIRE(pool.front(l) == 0);
+      REQUIRE(pool.back(l) == 4);
+      REQUIRE(pool.prev(nodes[0]) == pool.end());
+      REQUIRE(pool.next(nodes[4]) == pool.end());
+      REQUIRE(pool.prev(nodes[3]) == nodes[2]);
+      auto it = pool.end(l);
+      --it;
+      REQUIRE(*it == 4);
+      REQUIRE(it.node() == nodes[4]);
+    }
+
+    WHEN("a node in the middle is erased"){
+      const auto after = pool.erase(l, nodes[2]);
+      THEN("its neighbours are linked together"){
+        REQUIRE(after == nodes[3]);
+        REQUIRE(values(pool, l) == std::vector<int>{0, 1, 3, 4});
+        REQUIRE(reversed(pool, l) == std::vector<int>{4, 3, 1, 0});
+        REQUIRE(pool.size(l) == 4);
+      }
+      AND_WHEN("a value is inserted"){
+        const auto x = pool.insert_before(l, nodes[1], 10);
+        THEN("the erased node is reused"){
+          REQUIRE(x == nodes[2]);
+          REQUIRE(pool.psize() == 5);
+          REQUIRE(values(pool, l) == std::vector<int>{0, 10, 1, 3, 4});
+          REQUIRE(reversed(pool, l) == std::vector<int>{4, 3, 1, 10, 0});
+        }
+      }
+    }
+
+    WHEN("the ends are erased"){
+      pool.erase(l, nodes[0]);
+      pool.pop_back(l);
+      THEN("the ends of the list move"){
+        REQUIRE(values(pool, l) == std::vector<int>{1, 2, 3});
+        REQUIRE(pool.front(l) == 1);
+        REQUIRE(pool.back(l) == 3);
+        REQUIRE(pool.prev(nodes[1]) == pool.end());
+        REQUIRE(pool.next(nodes[3]) == pool.end());
+      }
+      AND_WHEN("values are pushed at both ends"){
+        pool.push_front(l, -1);
+        pool.emplace_back(l, 9);
+        THEN("they are the new ends"){
+          REQUIRE(values(pool, l) == std::vector<int>{-1, 1, 2, 3, 9});
+          REQUIRE(reversed(pool, l) == std::vector<int>{9, 3, 2, 1, -1});
+        }
+      }
+    }
+
+    WHEN("the list is emptied"){
+      for (int i=0; i<5; ++i)
+        pool.pop_front(l);
+      THEN("it is empty"){
+        REQUIRE(pool.empty(l));
+        REQUIRE(pool.size(l) == 0);
+        REQUIRE(pool.begin(l) == pool.end(l));
+        REQUIRE_THROWS(pool.pop_front(l));
+        REQUIRE_THROWS(pool.pop_back(l));
+        REQUIRE_THROWS(pool.front(l));
+        REQUIRE_THROWS(pool.erase(l, pool.end()));
+      }
+    }
+
+    WHEN("values are changed through the iterators"){
+      for (auto it = pool.rbegin(l); it != pool.rend(l); ++it)
+        *it += 10;
+      THEN("the list sees them"){
+        REQUIRE(values(pool, l) == std::vector<int>{10, 11, 12, 13, 14});
+      }
+    }
+
+    WHEN("the list is freed"){
+      pool.free_list(l);
+      THEN("its nodes are reused"){
+        REQUIRE(pool.empty(l));
+        auto m = pool.new_list();
+        for (int i=0; i<5; ++i)
+          pool.push_front(m, i);
+        REQUIRE(pool.psize() == 5);
+        REQUIRE(values(pool, m) == std::vector<int>{4, 3, 2, 1, 0});
+      }
+    }
+  }
+}
+
+SCENARIO("splicing lists"){
+  GIVEN("two lists"){
+    list_pool<std::string> pool{8};
+    auto a = pool.new_list();
+    auto b = pool.new_list();
+    std::vector<std::size_t> na, nb;
+    for (int i=0; i<3; ++i){
+      na.push_back(pool.push_back(a, "a" + std::to_string(i)));
+      nb.push_back(pool.push_back(b, "b" + std::to_string(i)));
+    }
+    auto strings = [&pool](const decltype(a)& l){
+      return std::vector<std::string>(pool.cbegin(l), pool.cend(l));
+    };
+
+    WHEN("a whole list is spliced in the middle of the other"){
+      pool.splice(a, na[1], b);
+      THEN("its nodes are moved, the other is empty"){
+        REQUIRE(strings(a) == std::vector<std::string>{"a0", "b0", "b1", "b2", "a1", "a2"});
+        REQUIRE(std::vector<std::string>(pool.crbegin(a), pool.crend(a)) ==
+                std::vector<std::string>{"a2", "a1", "b2", "b1", "b0", "a0"});
+        REQUIRE(pool.size(a) == 6);
+        REQUIRE(pool.empty(b));
+        REQUIRE(pool.value(nb[1]) == "b1");
+      }
+    }
+
+    WHEN("a whole list is spliced at the ends of the other"){
+      pool.splice(a, pool.end(), b);
+      THEN("it is appended"){
+        REQUIRE(strings(a) == std::vector<std::string>{"a0", "a1", "a2", "b0", "b1", "b2"});
+        REQUIRE(pool.back(a) == "b2");
+      }
+      AND_WHEN("it is spliced back at the front"){
+        auto c = pool.new_list();
+        pool.splice(c, c.head, a);
+        THEN("the empty list takes all"){
+          REQUIRE(strings(c) == std::vector<std::string>{"a0", "a1", "a2", "b0", "b1", "b2"});
+          REQUIRE(pool.empty(a));
+        }
+      }
+    }
+
+    WHEN("single nodes are spliced"){
+      pool.splice(a, na[0], b, nb[2]);
+      pool.splice(b, b.head, a, na[2]);
+      THEN("each moves to the other list"){
+        REQUIRE(strings(a) == std::vector<std::string>{"b2", "a0", "a1"});
+        REQUIRE(strings(b) == std::vector<std::string>{"a2", "b0", "b1"});
+        REQUIRE(pool.back(a) == "a1");
+        REQUIRE(pool.back(b) == "b1");
+        REQUIRE(pool.size(a) == 3);
+        REQUIRE(pool.size(b) == 3);
+      }
+    }
+
+    WHEN("a node is moved inside its list"){
+      pool.splice(a, pool.end(), a, na[0]);
+      pool.splice(a, na[1], a, na[1]);
+      THEN("the list is reordered"){
+        REQUIRE(strings(a) == std::vector<std::string>{"a1", "a2", "a0"});
+        REQUIRE(pool.size(a) == 3);
+        REQUIRE(pool.front(a) == "a1");
+      }
+    }
+  }
+}
+
+SCENARIO("many lists against std::list"){
+  GIVEN("random inserts, erases and splices on several lists"){
+    list_pool<int, std::uint32_t> pool{};
+    using list = list_pool<int, std::uint32_t>::list;
+    std::vector<list> ls(10, pool.new_list());
+    std::vector<std::list<int>> ref(10);
+    std::mt19937 gen{7};
+
+    // the node at position k of a list
+    auto nth = [&pool](const list& l, std::size_t k){
+      auto it = pool.cbegin(l);
+      for (; k>0; --k)
+        ++it;
+      return it.node();
+    };
+
+    for (int i=0; i<3000; ++i){
+      const auto k = gen() % ls.size();
+      const auto n = ref[k].size();
+      const auto pos = gen() % (n+1);
+      switch (gen() % 4){
+        case 0:
+        case 1:
+          pool.insert_before(ls[k], pos==n ? pool.end() : nth(ls[k], pos), i);
+          ref[k].insert(std::next(ref[k].begin(), pos), i);
+          break;
+        case 2:
+          if (pos < n){
+            pool.erase(ls[k], nth(ls[k], pos));
+            ref[k].erase(std::next(ref[k].begin(), pos));
+          }
+          break;
+        default:{
+          const auto j = gen() % ls.size();
+          if (pos < n && j != k){
+            pool.splice(ls[j], ls[j].head, ls[k], nth(ls[k], pos));
+            ref[j].splice(ref[j].begin(), ref[k], std::next(ref[k].begin(), pos));
+          }
+        }
+      }
+    }
+
+    THEN("every list matches its reference both ways"){
+      for (std::size_t k=0; k<ls.size(); ++k){
+        REQUIRE(pool.size(ls[k]) == ref[k].size());
+        REQUIRE(values(pool, ls[k]) == std::vector<int>(ref[k].begin(), ref[k].end()));
+        REQUIRE(reversed(pool, ls[k]) == std::vector<int>(ref[k].rbegin(), ref[k].rend()));
+      }
+    }
+  }
+}
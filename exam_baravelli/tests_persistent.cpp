@@ -0,0 +1,105 @@
+#include "catch.hpp"
+
+#include "persistent_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+template <typename P>
+std::vector<int> values(const P& pool, typename P::stack_type x){
+  return std::vector<int>(pool.pool().cbegin(x), pool.pool().cend(x));
+}
+
+SCENARIO("forking versions of a stack"){
+  GIVEN("a version of three nodes"){
+    persistent_pool<int, std::uint32_t> pool{};
+    auto base = pool.new_stack();
+    for (int i=0; i<3; ++i)
+      base = pool.push(i, base);
+    REQUIRE(pool.live_nodes() == 3);
+    REQUIRE(pool.use_count(base) == 1);
+
+    WHEN("two versions are pushed on it"){
+      auto a = pool.push(10, pool.share(base));
+      auto b = pool.push(20, pool.share(base));
+
+      THEN("they share its nodes"){
+        REQUIRE(values(pool, a) == std::vector<int>{10, 2, 1, 0});
+        REQUIRE(values(pool, b) == std::vector<int>{20, 2, 1, 0});
+        REQUIRE(values(pool, base) == std::vector<int>{2, 1, 0});
+        REQUIRE(pool.psize() == 5);
+        REQUIRE(pool.live_nodes() == 5);
+        REQUIRE(pool.use_count(base) == 3);
+        REQUIRE(pool.use_count(pool.next(base)) == 1);
+      }
+
+      AND_WHEN("versions are released"){
+        base = pool.free_stack(base);
+        a = pool.free_stack(a);
+        THEN("only the nodes nobody uses are freed"){
+          REQUIRE(pool.live_nodes() == 4);
+          REQUIRE(values(pool, b) == std::vector<int>{20, 2, 1, 0});
+          auto c = pool.push(30, pool.new_stack());
+          REQUIRE(pool.psize() == 5);
+          REQUIRE(pool.value(c) == 30);
+          b = pool.free_stack(b);
+          c = pool.free_stack(c);
+          REQUIRE(pool.live_nodes() == 0);
+        }
+      }
+
+      AND_WHEN("a shared version is popped"){
+        auto x = pool.pop(a);
+        THEN("the caller holds the version below, the shared node stays"){
+          REQUIRE(x == base);
+          REQUIRE(pool.use_count(base) == 3);
+          REQUIRE(pool.live_nodes() == 4);
+          x = pool.pop(x);
+          REQUIRE(pool.use_count(base) == 2);
+          REQUIRE(pool.use_count(x) == 2);
+          REQUIRE(values(pool, x) == std::vector<int>{1, 0});
+          REQUIRE(pool.live_nodes() == 4);
+        }
+      }
+    }
+
+    THEN("released versions cannot be used"){
+      const auto old = base;
+      base = pool.free_stack(base);
+      REQUIRE(pool.live_nodes() == 0);
+      REQUIRE_THROWS(pool.pop(old));
+      REQUIRE_THROWS(pool.share(old));
+      REQUIRE_THROWS(pool.push(1, old));
+      REQUIRE_THROWS(pool.pop(pool.end()));
+      REQUIRE_THROWS(pool.use_count(100));
+    }
+  }
+}
+
+SCENARIO("an undo history grows with the distinct nodes"){
+  persistent_pool<std::string, std::uint16_t> pool{};
+  std::vector<std::uint16_t> history{pool.new_stack()};
+  // each edit forks the previous state
+  for (int i=0; i<100; ++i)
+    history.push_back(pool.emplace(pool.share(history.back()), 1, char('a' + i % 26)));
+  REQUIRE(pool.psize() == 100);
+  REQUIRE(pool.ssize(history.back()) == 100);
+  REQUIRE(pool.reach(history[50], 50) == "a");
+
+  // undo 10 times and take another branch
+  auto branch = pool.share(history[90]);
+  for (int i=0; i<5; ++i)
+    branch = pool.push("branch", branch);
+  REQUIRE(pool.psize() == 105);
+  REQUIRE(pool.ssize(branch) == 95);
+
+  for (auto& h : history)
+    h = pool.free_stack(h);
+  REQUIRE(pool.live_nodes() == 95);
+  branch = pool.free_stack(branch);
+  REQUIRE(pool.live_nodes() == 0);
+}
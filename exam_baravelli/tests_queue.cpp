@@ -0,0 +1,157 @@
+#include "catch.hpp"
+
+#include "queue_pool.hpp"
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// since Makefile is available, use make check to compile
+
+
+template <typename P>
+std::vector<int> values(const P& pool, const typename P::queue& q){
+  return std::vector<int>(pool.cbegin(q), pool.cend(q));
+}
+
+SCENARIO("first in, first out"){
+  GIVEN("a queue with three values"){
+    queue_pool<int, std::uint32_t> pool{};
+    auto q = pool.new_queue();
+    REQUIRE(pool.empty(q));
+    for (int i=0; i<3; ++i)
+      q = pool.push_back(i, q);
+
+    THEN("the values are walked in the order they came"){
+      REQUIRE(values(pool, q) == std::vector<int>{0, 1, 2});
+      REQUIRE(pool.size(q) == 3);
+      REQUIRE(pool.front(q) == 0);
+      REQUIRE(pool.back(q) == 2);
+    }
+
+    WHEN("values are popped"){
+      q = pool.pop_front(q);
+      THEN("the oldest leaves first"){
+        REQUIRE(values(pool, q) == std::vector<int>{1, 2});
+        REQUIRE(pool.front(q) == 1);
+        REQUIRE(pool.back(q) == 2);
+      }
+
+      AND_WHEN("a value is pushed back"){
+        q = pool.push_back(3, q);
+        THEN("the popped node is reused"){
+          REQUIRE(pool.psize() == 3);
+          REQUIRE(values(pool, q) == std::vector<int>{1, 2, 3});
+        }
+      }
+
+      AND_WHEN("the queue is emptied"){
+        q = pool.pop_front(pool.pop_front(q));
+        THEN("it is empty and can grow again"){
+          REQUIRE(pool.empty(q));
+          REQUIRE(pool.size(q) == 0);
+          REQUIRE_THROWS(pool.pop_front(q));
+          REQUIRE_THROWS(pool.front(q));
+          REQUIRE_THROWS(pool.back(q));
+          q = pool.emplace_back(q, 7);
+          REQUIRE(pool.front(q) == 7);
+          REQUIRE(pool.back(q) == 7);
+        }
+      }
+    }
+
+    WHEN("values are changed through the iterators"){
+      for (auto it = pool.begin(q); it != pool.end(q); ++it)
+        *it *= 10;
+      pool.back(q) = 25;
+      THEN("the queue sees them"){
+        REQUIRE(values(pool, q) == std::vector<int>{0, 10, 25});
+      }
+    }
+  }
+}
+
+SCENARIO("concatenating and freeing queues"){
+  GIVEN("two queues interleaved in the pool"){
+    queue_pool<std::string> pool{10};
+    auto a = pool.new_queue();
+    auto b = pool.new_queue();
+    for (int i=0; i<3; ++i){
+      a = pool.push_back("a" + std::to_string(i), a);
+      b = pool.push_back("b" + std::to_string(i), b);
+    }
+
+    WHEN("they are concatenated"){
+      auto c = pool.concat(a, b);
+      THEN("the values of the second follow the first"){
+        REQUIRE(pool.size(c) == 6);
+        REQUIRE(std::vector<std::string>(pool.cbegin(c), pool.cend(c)) ==
+                std::vector<std::string>{"a0", "a1", "a2", "b0", "b1", "b2"});
+        REQUIRE(pool.back(c) == "b2");
+        c = pool.push_back("c", c);
+        REQUIRE(pool.back(c) == "c");
+        REQUIRE(pool.size(c) == 7);
+      }
+    }
+
+    WHEN("an empty queue is concatenated"){
+      auto e = pool.new_queue();
+      auto c = pool.concat(pool.concat(e, a), e);
+      THEN("the other one is unchanged"){
+        REQUIRE(pool.size(c) == 3);
+        REQUIRE(pool.front(c) == "a0");
+        REQUIRE(pool.back(c) == "a2");
+      }
+    }
+
+    WHEN("a queue is freed"){
+      a = pool.free_queue(a);
+      THEN("its nodes are reused"){
+        REQUIRE(pool.empty(a));
+        for (int i=0; i<3; ++i)
+          a = pool.push_back("x", a);
+        REQUIRE(pool.psize() == 6);
+        REQUIRE(pool.size(b) == 3);
+        REQUIRE(pool.front(b) == "b0");
+      }
+    }
+  }
+}
+
+SCENARIO("many queues against std::queue"){
+  GIVEN("random pushes and pops on several queues"){
+    queue_pool<int, std::uint32_t> pool{};
+    std::vector<queue_pool<int, std::uint32_t>::queue> qs(20, pool.new_queue());
+    std::vector<std::queue<int>> ref(20);
+    std::mt19937 gen{42};
+
+    for (int i=0; i<5000; ++i){
+      const auto k = gen() % qs.size();
+      if (gen() % 3 == 0 && !ref[k].empty()){
+        REQUIRE(pool.front(qs[k]) == ref[k].front());
+        qs[k] = pool.pop_front(qs[k]);
+        ref[k].pop();
+      }else{
+        qs[k] = pool.push_back(i, qs[k]);
+        ref[k].push(i);
+      }
+    }
+
+    THEN("every queue matches its reference"){
+      std::size_t live = 0;
+      for (std::size_t k=0; k<qs.size(); ++k){
+        REQUIRE(pool.size(qs[k]) == ref[k].size());
+        live += ref[k].size();
+        while (!ref[k].empty()){
+          REQUIRE(pool.front(qs[k]) == ref[k].front());
+          qs[k] = pool.pop_front(qs[k]);
+          ref[k].pop();
+        }
+        REQUIRE(pool.empty(qs[k]));
+      }
+      REQUIRE(pool.psize() >= live);
+    }
+  }
+}